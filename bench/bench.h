@@ -0,0 +1,56 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    bench.h
+ * @brief   Benchmark registry.
+ * @author  ael-mess
+ *
+ * @addtogroup BENCH
+ * @{
+ */
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include "stdint.h"
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+typedef struct {
+    const char* name;
+    void (*setup)(void);       /* optional, called once before warmup */
+    void (*run)(uint32_t n);   /* runs n operations */
+    void (*teardown)(void);    /* optional, called once after the samples */
+    uint32_t           ops;    /* operations per timed sample */
+    volatile uint32_t* errors; /* optional, failed operations, reset before setup */
+} bench_t;
+
+extern const bench_t bench_analytics_update;
+#ifdef ESP_PLATFORM
+extern const bench_t bench_nvs_counter;
+#if CONFIG_APP_BENCHMARK_OTA
+extern const bench_t bench_ota_write;
+#endif
+#endif
+extern const bench_t bench_payload_batch;
+extern const bench_t bench_payload_count;
+extern const bench_t bench_seq_check;
+extern const bench_t bench_series_append;
+extern const bench_t bench_series_query;
+extern const bench_t bench_tof_segment;
+extern const bench_t bench_track_update;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void bench_run_all(const char* filter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BENCH_H_ */
+
+/** @} */
@@ -0,0 +1,68 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    bench_analytics.c
+ * @brief   Analytics benchmarks.
+ * @author  ael-mess
+ *
+ * @addtogroup BENCH
+ * @{
+ */
+
+#include "stdlib.h"
+
+#include "app_analytics.h"
+
+#include "bench.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define TRACE_LEN 4096
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static app_analytics_t m_analytics;
+static uint16_t        m_trace[TRACE_LEN];
+static uint32_t        m_pos;
+static int64_t         m_now_us;
+static volatile uint32_t m_closed;
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static void setup(void) {
+    // occupancy random walk, one sample per second
+    srand(1);
+    int occupancy = 0;
+    for (int i = 0; i < TRACE_LEN; i++) {
+        occupancy += (rand() % 5) - 2;
+        occupancy = (occupancy < 0) ? 0 : occupancy;
+        m_trace[i] = (uint16_t)occupancy;
+    }
+
+    app_analytics_init(&m_analytics, APP_ANALYTICS_INTERVAL);
+    m_pos    = 0;
+    m_now_us = 0;
+}
+
+static void run(uint32_t n) {
+    app_analytics_summary_t summary;
+    for (uint32_t i = 0; i < n; i++) {
+        m_now_us += 1000000;
+        if (app_analytics_sample(&m_analytics, m_trace[m_pos], m_now_us, &summary)) {
+            m_closed++;
+        }
+        m_pos = (m_pos + 1) % TRACE_LEN;
+    }
+}
+
+const bench_t bench_analytics_update = {
+    .name  = "analytics_update",
+    .setup = setup,
+    .run   = run,
+    .ops   = 1000,
+};
+
+/** @} */
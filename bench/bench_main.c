@@ -0,0 +1,21 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    bench_main.c
+ * @brief   Host benchmark entry.
+ * @author  ael-mess
+ *
+ * @addtogroup BENCH
+ * @{
+ */
+
+#include "stddef.h"
+
+#include "bench.h"
+
+int main(int argc, char** argv) {
+    bench_run_all((argc > 1) ? argv[1] : NULL);
+    return 0;
+}
+
+/** @} */
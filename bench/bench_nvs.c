@@ -0,0 +1,60 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    bench_nvs.c
+ * @brief   NVS counter round trip benchmark.
+ * @note    Target only, NVS is initialized by app_main. The stored counter is
+ *          restored after the samples.
+ * @author  ael-mess
+ *
+ * @addtogroup BENCH
+ * @{
+ */
+
+#include "esp_system.h"
+
+#include "app_nvs.h"
+
+#include "bench.h"
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static uint16_t          m_saved;
+static uint16_t          m_value;
+static volatile uint32_t m_errors;
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static void setup(void) {
+    m_saved = app_nvs_get_counter();
+    m_value = m_saved;
+}
+
+static void run(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        // NVS skips writing an unchanged value, each round trip stores a new one
+        m_value++;
+        if ((app_nvs_set_counter(m_value) != ESP_OK) || (app_nvs_get_counter() != m_value)) {
+            m_errors++;
+        }
+    }
+}
+
+static void teardown(void) {
+    if (app_nvs_set_counter(m_saved) != ESP_OK) {
+        m_errors++;
+    }
+}
+
+const bench_t bench_nvs_counter = {
+    .name     = "nvs_counter",
+    .setup    = setup,
+    .run      = run,
+    .teardown = teardown,
+    .ops      = 1,
+    .errors   = &m_errors,
+};
+
+/** @} */
@@ -0,0 +1,76 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    bench_ota.c
+ * @brief   OTA image write benchmark.
+ * @note    Target only, with CONFIG_APP_BENCHMARK_OTA. Chunks are written
+ *          to the next update partition through app_ota_write(), then the
+ *          image is abandoned and the boot partition is left unchanged. An
+ *          operation is one chunk, the partition is erased by app_ota_init()
+ *          before the warmup: the rollback image it held is lost.
+ * @author  ael-mess
+ *
+ * @addtogroup BENCH
+ * @{
+ */
+
+#include "string.h"
+
+#include "esp_system.h"
+#include "esp_ota_ops.h"
+#include "esp_image_format.h"
+
+#include "app_ota.h"
+
+#include "bench.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define CHUNK_SIZE 1024 /* bytes per write, 210 samples of 4 chunks fill 860 KB of the 1 MB partition */
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static char              m_chunk[CHUNK_SIZE];
+static volatile uint32_t m_errors;
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static void setup(void) {
+    // a description of another version, or the update is refused
+    esp_app_desc_t desc = *esp_ota_get_app_description();
+    strncpy(desc.version, "bench", sizeof(desc.version));
+    if (app_ota_init((const char*)&desc, sizeof(desc)) != ESP_OK) {
+        m_errors++;
+    }
+
+    for (int i = 0; i < CHUNK_SIZE; i++) {
+        m_chunk[i] = (char)(i * 31);
+    }
+    // accepted by esp_ota_write(), with an invalid segment count the image never validates
+    m_chunk[0] = ESP_IMAGE_HEADER_MAGIC;
+    m_chunk[1] = (char)0xFF;
+}
+
+static void run(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        if (app_ota_write(m_chunk, CHUNK_SIZE) != ESP_OK) {
+            m_errors++;
+        }
+    }
+}
+
+static void teardown(void) { app_ota_abort(); }
+
+const bench_t bench_ota_write = {
+    .name     = "ota_write",
+    .setup    = setup,
+    .run      = run,
+    .teardown = teardown,
+    .ops      = 4,
+    .errors   = &m_errors,
+};
+
+/** @} */
@@ -0,0 +1,80 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    bench_payload.c
+ * @brief   Counter record encoding benchmarks.
+ * @author  ael-mess
+ *
+ * @addtogroup BENCH
+ * @{
+ */
+
+#include "stdlib.h"
+
+#include "app_payload.h"
+
+#include "bench.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define TRACE_LEN   256
+#define BATCH       8
+#define BOOT_UTC_MS 1666180800000LL
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static app_record_t      m_trace[TRACE_LEN];
+static char              m_buf[64 + BATCH * APP_PAYLOAD_RECORD_SIZE];
+static uint32_t          m_pos;
+static volatile uint32_t m_bytes;
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static bool to_utc(int64_t mono_us, int64_t* utc_ms) {
+    *utc_ms = BOOT_UTC_MS + mono_us / 1000;
+    return true;
+}
+
+static void setup(void) {
+    // one sample per second, a few people in the room
+    srand(1);
+    for (int i = 0; i < TRACE_LEN; i++) {
+        m_trace[i].seq     = 100000 + i;
+        m_trace[i].count   = (uint16_t)(rand() % 40);
+        m_trace[i].mono_us = 3600000000LL + i * 1000000LL + rand() % 1000;
+    }
+    m_pos = 0;
+}
+
+static void run_count(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        m_bytes += app_payload_encode(m_buf, sizeof(m_buf), &m_trace[m_pos], 1, to_utc);
+        m_pos = (m_pos + 1) % TRACE_LEN;
+    }
+}
+
+static void run_batch(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        m_bytes += app_payload_encode(m_buf, sizeof(m_buf), &m_trace[m_pos], BATCH, to_utc);
+        m_pos = (m_pos + BATCH) % TRACE_LEN;
+    }
+}
+
+const bench_t bench_payload_count = {
+    .name  = "payload_count",
+    .setup = setup,
+    .run   = run_count,
+    .ops   = 100,
+};
+
+const bench_t bench_payload_batch = {
+    .name  = "payload_batch",
+    .setup = setup,
+    .run   = run_batch,
+    .ops   = 10,
+};
+
+/** @} */
@@ -0,0 +1,161 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    bench_run.c
+ * @brief   Benchmark runner.
+ * @note    Built for the host (bench_main.c) and in the benchmark firmware
+ *          (CONFIG_APP_BENCHMARK). Samples are timed with the monotonic clock
+ *          on the host and with the CPU cycle counter on target, where the
+ *          results also carry cycles.
+ * @author  ael-mess
+ *
+ * @addtogroup BENCH
+ * @{
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#include "esp_ota_ops.h"
+#include "soc/cpu.h"
+#endif
+
+#include "bench.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define BENCH_WARMUP  10
+#define BENCH_SAMPLES 200
+
+#ifdef ESP_PLATFORM
+#define BENCH_CPU_MHZ CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ
+#endif
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static const bench_t* const m_benches[] = {
+    &bench_analytics_update,
+#ifdef ESP_PLATFORM
+    &bench_nvs_counter,
+#if CONFIG_APP_BENCHMARK_OTA
+    &bench_ota_write,
+#endif
+#endif
+    &bench_payload_batch,
+    &bench_payload_count,
+    &bench_seq_check,
+    &bench_series_append,
+    &bench_series_query,
+    &bench_tof_segment,
+    &bench_track_update,
+};
+
+static uint64_t m_samples[BENCH_SAMPLES];
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+#ifdef ESP_PLATFORM
+static uint32_t now_ticks(void) {
+    // wraps after 26 s at 160 MHz, far above a sample
+    return esp_cpu_get_ccount();
+}
+#else
+static uint64_t now_ticks(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_run(const bench_t* bench) {
+    if (bench->errors) {
+        *bench->errors = 0;
+    }
+    if (bench->setup) {
+        bench->setup();
+    }
+
+    for (int i = 0; i < BENCH_WARMUP; i++) {
+        bench->run(bench->ops);
+    }
+
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+#ifdef ESP_PLATFORM
+        uint32_t start = now_ticks();
+        bench->run(bench->ops);
+        m_samples[i] = (uint32_t)(now_ticks() - start);
+#else
+        uint64_t start = now_ticks();
+        bench->run(bench->ops);
+        m_samples[i] = now_ticks() - start;
+#endif
+    }
+    qsort(m_samples, BENCH_SAMPLES, sizeof(uint64_t), cmp_u64);
+
+    if (bench->teardown) {
+        bench->teardown();
+    }
+
+    // one JSON object per line, per operation cost
+    double p50 = (double)m_samples[BENCH_SAMPLES / 2] / bench->ops;
+    double p90 = (double)m_samples[BENCH_SAMPLES * 90 / 100] / bench->ops;
+    double p99 = (double)m_samples[BENCH_SAMPLES * 99 / 100] / bench->ops;
+    double   max    = (double)m_samples[BENCH_SAMPLES - 1] / bench->ops;
+    uint32_t errors = bench->errors ? *bench->errors : 0;
+#ifdef ESP_PLATFORM
+    printf("{\"bench\":\"%s\",\"ops\":%u,\"p50_cycles\":%.1f,\"p90_cycles\":%.1f,\"p99_cycles\":%.1f,"
+           "\"max_cycles\":%.1f,\"p50_ns\":%.1f,\"p90_ns\":%.1f,\"p99_ns\":%.1f,\"max_ns\":%.1f,\"errors\":%u}\n",
+           bench->name, bench->ops, p50, p90, p99, max, p50 * 1000 / BENCH_CPU_MHZ, p90 * 1000 / BENCH_CPU_MHZ,
+           p99 * 1000 / BENCH_CPU_MHZ, max * 1000 / BENCH_CPU_MHZ, errors);
+#else
+    printf("{\"bench\":\"%s\",\"ops\":%u,\"p50_ns\":%.1f,\"p90_ns\":%.1f,\"p99_ns\":%.1f,\"max_ns\":%.1f,"
+           "\"errors\":%u}\n",
+           bench->name, bench->ops, p50, p90, p99, max, errors);
+#endif
+}
+
+/**
+ * @brief   Run the registered benchmarks.
+ * @note    On target, a first line gives the firmware version and the CPU
+ *          frequency, and a last line the number of benchmarks run, to
+ *          capture the results from the UART output.
+ *
+ * @param[in] filter    only run the benchmarks whose name contains it, all of them if NULL or empty
+ *
+ */
+void bench_run_all(const char* filter) {
+    unsigned run = 0;
+
+#ifdef ESP_PLATFORM
+    const esp_app_desc_t* desc = esp_ota_get_app_description();
+    printf("{\"target\":\"esp32\",\"version\":\"%s\",\"idf\":\"%s\",\"cpu_mhz\":%d}\n", desc->version,
+           desc->idf_ver, BENCH_CPU_MHZ);
+#endif
+
+    for (size_t i = 0; i < sizeof(m_benches) / sizeof(m_benches[0]); i++) {
+        if ((filter != NULL) && (strstr(m_benches[i]->name, filter) == NULL)) {
+            continue;
+        }
+        bench_run(m_benches[i]);
+        run++;
+    }
+
+#ifdef ESP_PLATFORM
+    printf("{\"done\":%u}\n", run);
+#endif
+}
+
+/** @} */
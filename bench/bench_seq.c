@@ -0,0 +1,69 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    bench_seq.c
+ * @brief   Record sequence window benchmarks.
+ * @author  ael-mess
+ *
+ * @addtogroup BENCH
+ * @{
+ */
+
+#include "stdlib.h"
+
+#include "seq_window.h"
+
+#include "bench.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define TRACE_LEN 4096
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static seq_window_t      m_window;
+static int32_t           m_trace[TRACE_LEN]; /* offsets from the in order number */
+static uint32_t          m_pos;
+static uint32_t          m_seq;
+static volatile uint32_t m_dropped;
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static void setup(void) {
+    // QoS 1 ingest: in order, with 2% retransmitted duplicates, 1% reordered and 1% gaps
+    srand(1);
+    for (int i = 0; i < TRACE_LEN; i++) {
+        int r      = rand() % 100;
+        m_trace[i]  = (r < 2) ? -1 - (rand() % 8) : (r < 3) ? -(rand() % 64) : (r < 4) ? 1 + (rand() % 16) : 0;
+    }
+
+    seq_window_init(&m_window);
+    m_pos = 0;
+    m_seq = 0;
+}
+
+static void run(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        m_seq++;
+        if (m_trace[m_pos] > 0) {
+            m_seq += m_trace[m_pos];
+        }
+        uint32_t seq = (m_trace[m_pos] < 0) ? m_seq + m_trace[m_pos] : m_seq;
+        if (seq_window_check(&m_window, seq) >= SEQ_DUPLICATE) {
+            m_dropped++;
+        }
+        m_pos = (m_pos + 1) % TRACE_LEN;
+    }
+}
+
+const bench_t bench_seq_check = {
+    .name  = "seq_check",
+    .setup = setup,
+    .run   = run,
+    .ops   = 1000,
+};
+
+/** @} */
@@ -0,0 +1,97 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    bench_series.c
+ * @brief   Counter history store benchmarks.
+ * @note    A 128 KB emulated flash holds 30 days of per minute points, the
+ *          flash time itself is modelled by series_sim. Appends go on from
+ *          the last point, queries read one hour at a random time.
+ * @author  ael-mess
+ *
+ * @addtogroup BENCH
+ * @{
+ */
+
+#include "stdlib.h"
+
+#include "app_series.h"
+#include "flash_emu.h"
+
+#include "bench.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#ifdef ESP_PLATFORM
+#define FLASH_SIZE   (32 * 1024) /* emulated in RAM */
+#define FILL_MINUTES (4 * 24 * 60)
+#else
+#define FLASH_SIZE   (128 * 1024)
+#define FILL_MINUTES (30 * 24 * 60)
+#endif
+#define SECTOR_SIZE  4096
+#define START_MINUTE 27769680
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static uint8_t           m_data[FLASH_SIZE];
+static flash_emu_t       m_flash;
+static app_series_t      m_series;
+static uint32_t          m_minute;
+static uint16_t          m_value;
+static volatile uint32_t m_points;
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static void setup(void) {
+    app_series_flash_t ops = {
+        .read        = flash_emu_read,
+        .write       = flash_emu_write,
+        .erase       = flash_emu_erase,
+        .ctx         = &m_flash,
+        .size        = FLASH_SIZE,
+        .sector_size = SECTOR_SIZE,
+    };
+    flash_emu_init(&m_flash, m_data, FLASH_SIZE, SECTOR_SIZE);
+    app_series_init(&m_series, &ops);
+
+    srand(1);
+    m_value = 0;
+    for (m_minute = START_MINUTE; m_minute < START_MINUTE + FILL_MINUTES; m_minute++) {
+        m_value = (uint16_t)(m_value + (rand() % 3) - 1);
+        app_series_append(&m_series, m_minute, m_value);
+    }
+}
+
+static void run_append(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        m_value = (uint16_t)(m_value + (rand() % 3) - 1);
+        app_series_append(&m_series, m_minute++, m_value);
+    }
+}
+
+static void run_query(uint32_t n) {
+    app_series_point_t points[60];
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t from = m_minute - 60 - (uint32_t)(rand() % (FILL_MINUTES - 60));
+        m_points += app_series_query(&m_series, from, from + 59, points, 60);
+    }
+}
+
+const bench_t bench_series_append = {
+    .name  = "series_append",
+    .setup = setup,
+    .run   = run_append,
+    .ops   = 100,
+};
+
+const bench_t bench_series_query = {
+    .name  = "series_query",
+    .setup = setup,
+    .run   = run_query,
+    .ops   = 100,
+};
+
+/** @} */
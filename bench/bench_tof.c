@@ -0,0 +1,93 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    bench_tof.c
+ * @brief   Depth frame segmentation benchmarks.
+ * @note    Frames are replayed from the raw recording named by BENCH_TOF_FRAMES
+ *          (64 little endian uint16 depths in mm per frame, as read from the
+ *          sensor) when set, otherwise from a synthetic 15 Hz scene.
+ * @author  ael-mess
+ *
+ * @addtogroup BENCH
+ * @{
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+
+#include "app_tof.h"
+#include "app_scene.h"
+
+#include "bench.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#ifdef ESP_PLATFORM
+#define TRACE_FRAMES 64 /* 8 KB of frames in RAM */
+#else
+#define TRACE_FRAMES 4096
+#endif
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static uint16_t          m_frames[TRACE_FRAMES][APP_TOF_PIXELS];
+static uint32_t          m_count;
+static uint32_t          m_pos;
+static app_tof_t         m_tof;
+static volatile uint32_t m_blobs;
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static uint32_t load(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "%s: cannot open, synthetic frames used\n", path);
+        return 0;
+    }
+
+    uint32_t count = (uint32_t)fread(m_frames, sizeof(m_frames[0]), TRACE_FRAMES, f);
+    fclose(f);
+    for (uint32_t i = 0; i < count; i++) {
+        for (int j = 0; j < APP_TOF_PIXELS; j++) {
+            const uint8_t* b = (const uint8_t*)&m_frames[i][j];
+            m_frames[i][j]   = (uint16_t)(b[0] | (b[1] << 8));
+        }
+    }
+    return count;
+}
+
+static void setup(void) {
+    const char* path = getenv("BENCH_TOF_FRAMES");
+    m_count          = (path != NULL) ? load(path) : 0;
+
+    if (m_count == 0) {
+        app_scene_t scene;
+        app_scene_init(&scene, 1, 15);
+        for (m_count = 0; m_count < TRACE_FRAMES; m_count++) {
+            app_scene_frame(&scene, m_frames[m_count]);
+        }
+    }
+
+    app_tof_init(&m_tof);
+    m_pos = 0;
+}
+
+static void run(uint32_t n) {
+    app_tof_blob_t blobs[APP_TOF_MAX_BLOBS];
+    for (uint32_t i = 0; i < n; i++) {
+        m_blobs += app_tof_process(&m_tof, m_frames[m_pos], blobs, APP_TOF_MAX_BLOBS);
+        m_pos = (m_pos + 1) % m_count;
+    }
+}
+
+const bench_t bench_tof_segment = {
+    .name  = "tof_segment",
+    .setup = setup,
+    .run   = run,
+    .ops   = 100,
+};
+
+/** @} */
@@ -0,0 +1,72 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    bench_track.c
+ * @brief   People tracker benchmarks.
+ * @note    The detections of a synthetic 15 Hz scene are segmented once, then
+ *          replayed through the tracker.
+ * @author  ael-mess
+ *
+ * @addtogroup BENCH
+ * @{
+ */
+
+#include "app_scene.h"
+#include "app_tof.h"
+#include "app_track.h"
+
+#include "bench.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#ifdef ESP_PLATFORM
+#define TRACE_FRAMES 64 /* 8 KB of detections in RAM */
+#else
+#define TRACE_FRAMES 4096
+#endif
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static app_tof_blob_t    m_blobs[TRACE_FRAMES][APP_TOF_MAX_BLOBS];
+static uint8_t           m_counts[TRACE_FRAMES];
+static uint32_t          m_pos;
+static app_track_t       m_track;
+static volatile uint32_t m_events;
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static void setup(void) {
+    static app_scene_t scene;
+    static app_tof_t   tof;
+
+    app_scene_init(&scene, 1, 15);
+    app_tof_init(&tof);
+    for (int i = 0; i < TRACE_FRAMES; i++) {
+        uint16_t depth[APP_TOF_PIXELS];
+        app_scene_frame(&scene, depth);
+        m_counts[i] = (uint8_t)app_tof_process(&tof, depth, m_blobs[i], APP_TOF_MAX_BLOBS);
+    }
+
+    app_track_init(&m_track);
+    m_pos = 0;
+}
+
+static void run(uint32_t n) {
+    app_track_event_t events[APP_TRACK_MAX];
+    for (uint32_t i = 0; i < n; i++) {
+        m_events += app_track_update(&m_track, m_blobs[m_pos], m_counts[m_pos], events, APP_TRACK_MAX);
+        m_pos = (m_pos + 1) % TRACE_FRAMES;
+    }
+}
+
+const bench_t bench_track_update = {
+    .name  = "track_update",
+    .setup = setup,
+    .run   = run,
+    .ops   = 100,
+};
+
+/** @} */
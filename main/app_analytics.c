@@ -0,0 +1,225 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_analytics.c
+ * @brief   Occupancy and dwell-time analytics.
+ * @note    Pure C, no ESP-IDF dependency, every update runs in O(1) on fixed memory.
+ * @author  ael-mess
+ *
+ * @addtogroup MAIN
+ * @{
+ */
+
+#include "stdio.h"
+#include "string.h"
+
+#include "app_analytics.h"
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static uint32_t dwell_quantile(const uint32_t hist[APP_ANALYTICS_DWELL_BINS], uint32_t total, uint32_t percent) {
+    if (total == 0) {
+        return 0;
+    }
+
+    uint32_t rank = (total * percent + 99) / 100;
+    uint32_t sum  = 0;
+    for (int b = 0; b < APP_ANALYTICS_DWELL_BINS; b++) {
+        sum += hist[b];
+        if (sum >= rank) {
+            return (1u << (b + 1)) - 1;
+        }
+    }
+    return (1u << APP_ANALYTICS_DWELL_BINS) - 1;
+}
+
+static void close_interval(app_analytics_t* a, int64_t duration_us, app_analytics_summary_t* summary) {
+    uint32_t total = 0;
+    for (int b = 0; b < APP_ANALYTICS_DWELL_BINS; b++) {
+        total += a->dwell_hist[b];
+    }
+
+    summary->start_us    = a->start_us;
+    summary->duration_ms = (uint32_t)(duration_us / 1000);
+    summary->occupancy   = a->occupancy;
+    summary->peak        = a->peak;
+    summary->mean_x100   = (uint32_t)(a->occ_us * 100 / (uint64_t)duration_us);
+    summary->entries     = a->entries;
+    summary->exits       = a->exits;
+    // Little's law: mean dwell = occupancy integral / arrivals
+    summary->dwell_s     = a->entries ? (uint32_t)(a->occ_us / 1000000 / a->entries) : 0;
+    summary->dwell_p50_s = dwell_quantile(a->dwell_hist, total, 50);
+    summary->dwell_p90_s = dwell_quantile(a->dwell_hist, total, 90);
+    memcpy(summary->entry_hist, a->entry_hist, sizeof(a->entry_hist));
+    memcpy(summary->exit_hist, a->exit_hist, sizeof(a->exit_hist));
+
+    a->occ_us  = 0;
+    a->peak    = a->occupancy;
+    a->entries = 0;
+    a->exits   = 0;
+    memset(a->entry_hist, 0, sizeof(a->entry_hist));
+    memset(a->exit_hist, 0, sizeof(a->exit_hist));
+    memset(a->dwell_hist, 0, sizeof(a->dwell_hist));
+}
+
+static void fifo_push(app_analytics_t* a, int64_t now_us) {
+    if (a->fifo_len == APP_ANALYTICS_DWELL_SLOTS) {
+        // oldest entry is forgotten, its exit will pair with the next one
+        a->fifo_head = (a->fifo_head + 1) % APP_ANALYTICS_DWELL_SLOTS;
+        a->fifo_len--;
+    }
+    a->fifo[(a->fifo_head + a->fifo_len) % APP_ANALYTICS_DWELL_SLOTS] = now_us;
+    a->fifo_len++;
+}
+
+static void fifo_pop(app_analytics_t* a, int64_t now_us) {
+    if (a->fifo_len == 0) {
+        return;
+    }
+
+    // first in, first out: the exit is paired with the oldest entry
+    uint32_t dwell_s = (uint32_t)((now_us - a->fifo[a->fifo_head]) / 1000000);
+    int      bin     = 31 - __builtin_clz(dwell_s + 1);
+    if (bin >= APP_ANALYTICS_DWELL_BINS) {
+        bin = APP_ANALYTICS_DWELL_BINS - 1;
+    }
+    a->dwell_hist[bin]++;
+
+    a->fifo_head = (a->fifo_head + 1) % APP_ANALYTICS_DWELL_SLOTS;
+    a->fifo_len--;
+}
+
+/**
+ * @brief   Initialize analytics state.
+ *
+ * @param[out] a        analytics state pointer
+ * @param[in] interval_s summary interval in seconds
+ *
+ */
+void app_analytics_init(app_analytics_t* a, uint32_t interval_s) {
+    memset(a, 0, sizeof(app_analytics_t));
+    a->interval_us = (int64_t)interval_s * 1000000;
+}
+
+/**
+ * @brief   Account entries and exits.
+ *
+ * @param[in,out] a     analytics state pointer
+ * @param[in] entries   entries since last update
+ * @param[in] exits     exits since last update
+ * @param[in] now_us    event time, monotonic clock
+ * @param[out] summary  summary of the closed interval
+ * @return              retrun true if an interval was closed and summary is filled
+ *
+ */
+bool app_analytics_update(app_analytics_t* a, uint16_t entries, uint16_t exits, int64_t now_us,
+                          app_analytics_summary_t* summary) {
+    bool closed = false;
+
+    if (!a->started) {
+        a->start_us = now_us;
+        a->last_us  = now_us;
+        a->peak     = a->occupancy;
+        a->started  = true;
+    }
+
+    int64_t end_us = a->start_us + a->interval_us;
+    if (now_us >= end_us) {
+        // idle intervals are not reported on their own, the closed one stretches over them with the held occupancy
+        if (now_us - end_us >= a->interval_us) {
+            end_us = now_us;
+        }
+        a->occ_us += (uint64_t)a->occupancy * (uint64_t)(end_us - a->last_us);
+        close_interval(a, end_us - a->start_us, summary);
+        closed = true;
+
+        a->start_us = end_us;
+        a->last_us  = end_us;
+    }
+    a->occ_us += (uint64_t)a->occupancy * (uint64_t)(now_us - a->last_us);
+    a->last_us = now_us;
+
+    int bin = (int)((now_us - a->start_us) * APP_ANALYTICS_BINS / a->interval_us);
+    if (bin >= APP_ANALYTICS_BINS) {
+        bin = APP_ANALYTICS_BINS - 1;
+    }
+
+    for (uint16_t i = 0; i < entries; i++) {
+        fifo_push(a, now_us);
+    }
+    for (uint16_t i = 0; i < exits; i++) {
+        fifo_pop(a, now_us);
+    }
+
+    a->entries += entries;
+    a->exits += exits;
+    a->entry_hist[bin] += entries;
+    a->exit_hist[bin] += exits;
+
+    uint32_t occupancy = (uint32_t)a->occupancy + entries;
+    occupancy          = (occupancy > exits) ? occupancy - exits : 0;
+    a->occupancy       = (occupancy > UINT16_MAX) ? UINT16_MAX : (uint16_t)occupancy;
+    if (a->occupancy > a->peak) {
+        a->peak = a->occupancy;
+    }
+
+    return closed;
+}
+
+/**
+ * @brief   Account an occupancy sample.
+ * @note    Entries and exits are derived from the occupancy change, the first sample sets the baseline.
+ *
+ * @param[in,out] a     analytics state pointer
+ * @param[in] occupancy current occupancy
+ * @param[in] now_us    sample time, monotonic clock
+ * @param[out] summary  summary of the closed interval
+ * @return              retrun true if an interval was closed and summary is filled
+ *
+ */
+bool app_analytics_sample(app_analytics_t* a, uint16_t occupancy, int64_t now_us, app_analytics_summary_t* summary) {
+    if (!a->started) {
+        a->occupancy = occupancy;
+    }
+
+    uint16_t entries = (occupancy > a->occupancy) ? occupancy - a->occupancy : 0;
+    uint16_t exits   = (occupancy < a->occupancy) ? a->occupancy - occupancy : 0;
+    return app_analytics_update(a, entries, exits, now_us, summary);
+}
+
+/**
+ * @brief   Encode summary record.
+ *
+ * @param[in] summary   summary pointer
+ * @param[in] ts_ms     interval start timestamp
+ * @param[out] buf      output buffer
+ * @param[in] len       output buffer size
+ * @return              encoded length, 0 if the buffer is too small
+ *
+ */
+size_t app_analytics_encode(const app_analytics_summary_t* summary, int64_t ts_ms, char* buf, size_t len) {
+    int n = snprintf(buf, len,
+                     "{\"type\":\"summary\",\"ts\":%lld,\"dur\":%u,\"occ\":%u,\"peak\":%u,\"mean\":%u,\"in\":%u,"
+                     "\"out\":%u,\"dwell\":%u,\"p50\":%u,\"p90\":%u,\"hin\":[",
+                     (long long)ts_ms, (unsigned)summary->duration_ms, summary->occupancy, summary->peak,
+                     (unsigned)summary->mean_x100, (unsigned)summary->entries, (unsigned)summary->exits,
+                     (unsigned)summary->dwell_s, (unsigned)summary->dwell_p50_s, (unsigned)summary->dwell_p90_s);
+
+    for (int b = 0; (b < APP_ANALYTICS_BINS) && (n > 0) && ((size_t)n < len); b++) {
+        n += snprintf(buf + n, len - n, b ? ",%u" : "%u", summary->entry_hist[b]);
+    }
+    if ((n > 0) && ((size_t)n < len)) {
+        n += snprintf(buf + n, len - n, "],\"hout\":[");
+    }
+    for (int b = 0; (b < APP_ANALYTICS_BINS) && (n > 0) && ((size_t)n < len); b++) {
+        n += snprintf(buf + n, len - n, b ? ",%u" : "%u", summary->exit_hist[b]);
+    }
+    if ((n > 0) && ((size_t)n < len)) {
+        n += snprintf(buf + n, len - n, "]}");
+    }
+
+    return ((n > 0) && ((size_t)n < len)) ? (size_t)n : 0;
+}
+
+/** @} */
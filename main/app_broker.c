@@ -0,0 +1,158 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_broker.c
+ * @brief   Ordered broker list with health tracking.
+ * @note    Pure C, no ESP-IDF dependency. The primary broker comes first, then
+ *          the fallbacks in their configured order. A broker that refused or
+ *          lost the connection is skipped for an exponential back-off, the
+ *          highest priority broker out of back-off is selected.
+ * @author  ael-mess
+ *
+ * @addtogroup NET
+ * @{
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#include "app_broker.h"
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static void broker_add(app_broker_list_t* list, const char* host, size_t len, uint16_t port) {
+    if ((list->count >= APP_BROKER_MAX) || (len == 0) || (len >= APP_BROKER_HOST_LEN) || (port == 0)) {
+        return;
+    }
+
+    app_broker_t* b = &list->brokers[list->count++];
+    memcpy(b->host, host, len);
+    b->host[len] = '\0';
+    b->port      = port;
+}
+
+/**
+ * @brief   Initialize the broker list.
+ * @note    Fallbacks are "host[:port]" separated by commas or spaces, a missing
+ *          port is the primary port. Entries beyond APP_BROKER_MAX are ignored.
+ *
+ * @param[out] list     broker list pointer
+ * @param[in] host      primary broker host
+ * @param[in] port      primary broker port
+ * @param[in] fallbacks fallback brokers, may be NULL
+ * @return              number of brokers
+ *
+ */
+size_t app_broker_init(app_broker_list_t* list, const char* host, uint16_t port, const char* fallbacks) {
+    memset(list, 0, sizeof(app_broker_list_t));
+    broker_add(list, host, strlen(host), port);
+
+    for (const char* p = fallbacks; (p != NULL) && (*p != '\0');) {
+        p += strspn(p, ", ");
+        size_t len = strcspn(p, ", ");
+        if (len == 0) {
+            break;
+        }
+
+        const char* colon = memchr(p, ':', len);
+        uint16_t    entry = port;
+        size_t      n     = len;
+        if (colon != NULL) {
+            n     = (size_t)(colon - p);
+            entry = (uint16_t)strtoul(colon + 1, NULL, 10);
+        }
+        broker_add(list, p, n, entry);
+        p += len;
+    }
+    return list->count;
+}
+
+/**
+ * @brief   Record a successful connection.
+ *
+ * @param[in,out] list  broker list pointer
+ * @param[in] index     broker index
+ *
+ */
+void app_broker_up(app_broker_list_t* list, int index) {
+    app_broker_t* b = &list->brokers[index];
+    b->up           = true;
+    b->failures     = 0;
+    b->retry_us     = 0;
+    b->connects++;
+}
+
+/**
+ * @brief   Record a refused or lost connection.
+ *
+ * @param[in,out] list  broker list pointer
+ * @param[in] index     broker index
+ * @param[in] now_us    failure time, monotonic clock
+ *
+ */
+void app_broker_down(app_broker_list_t* list, int index, int64_t now_us) {
+    app_broker_t* b = &list->brokers[index];
+    if (b->up) {
+        b->drops++;
+    }
+    b->up = false;
+    b->failures++;
+
+    uint32_t backoff_ms = APP_BROKER_BACKOFF_MS;
+    for (uint32_t i = 1; (i < b->failures) && (backoff_ms < APP_BROKER_BACKOFF_MAX); i++) {
+        backoff_ms *= 2;
+    }
+    backoff_ms  = (backoff_ms > APP_BROKER_BACKOFF_MAX) ? APP_BROKER_BACKOFF_MAX : backoff_ms;
+    b->retry_us = now_us + backoff_ms * 1000LL;
+}
+
+/**
+ * @brief   Select a broker.
+ *
+ * @param[in] list      broker list pointer
+ * @param[in] now_us    current time, monotonic clock
+ * @param[in] exclude   broker index not to select, -1 for none
+ * @return              highest priority broker out of back-off, -1 if none
+ *
+ */
+int app_broker_pick(const app_broker_list_t* list, int64_t now_us, int exclude) {
+    for (size_t i = 0; i < list->count; i++) {
+        if (((int)i != exclude) && (list->brokers[i].retry_us <= now_us)) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief   Encode broker health record.
+ *
+ * @param[in] list      broker list pointer
+ * @param[in] active    broker index of the active session, -1 for none
+ * @param[in] standby   broker index of the standby session, -1 for none
+ * @param[out] buf      output buffer
+ * @param[in] len       output buffer size
+ * @return              encoded length, 0 if the buffer is too small
+ *
+ */
+size_t app_broker_encode(const app_broker_list_t* list, int active, int standby, char* buf, size_t len) {
+    int n = snprintf(buf, len, "{ \"type\": \"brokers\", \"active\": %d, \"standby\": %d, \"brokers\": [", active,
+                     standby);
+
+    for (size_t i = 0; (i < list->count) && (n > 0) && ((size_t)n < len); i++) {
+        const app_broker_t* b = &list->brokers[i];
+        n += snprintf(buf + n, len - n,
+                      "%s{ \"host\": \"%s\", \"port\": %u, \"up\": %s, \"failures\": %u, \"connects\": %u, "
+                      "\"drops\": %u }",
+                      i ? ", " : "", b->host, b->port, b->up ? "true" : "false", (unsigned)b->failures,
+                      (unsigned)b->connects, (unsigned)b->drops);
+    }
+    if ((n > 0) && ((size_t)n < len)) {
+        n += snprintf(buf + n, len - n, "] }");
+    }
+    return ((n > 0) && ((size_t)n < len)) ? (size_t)n : 0;
+}
+
+/** @} */
@@ -0,0 +1,213 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_coap.c
+ * @brief   CoAP message codec.
+ * @note    Pure C, no ESP-IDF dependency, subset of RFC 7252 needed by the uplink:
+ *          Uri-Path, Content-Format and No-Response (RFC 7967) options.
+ * @author  ael-mess
+ *
+ * @addtogroup NET
+ * @{
+ */
+
+#include "string.h"
+
+#include "app_coap.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define COAP_VERSION       1
+#define OPT_URI_PATH       11
+#define OPT_CONTENT_FORMAT 12
+#define OPT_NO_RESPONSE    258
+#define NO_RESPONSE_2XX    2
+#define PAYLOAD_MARKER     0xff
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static uint8_t opt_nibble(uint32_t value) { return (value < 13) ? value : (value < 269) ? 13 : 14; }
+
+static size_t opt_ext(uint32_t value, uint8_t* p) {
+    if (value < 13) {
+        return 0;
+    }
+    if (value < 269) {
+        p[0] = (uint8_t)(value - 13);
+        return 1;
+    }
+    p[0] = (uint8_t)((value - 269) >> 8);
+    p[1] = (uint8_t)(value - 269);
+    return 2;
+}
+
+static size_t opt_put(uint8_t* buf, size_t len, size_t n, uint16_t* last, uint16_t number, const void* value,
+                      size_t value_len) {
+    uint32_t delta = number - *last;
+    if ((n == 0) || (n + 5 + value_len > len)) {
+        return 0;
+    }
+
+    uint8_t* p = buf + n;
+    size_t   h = 1;
+    p[0]       = (uint8_t)((opt_nibble(delta) << 4) | opt_nibble(value_len));
+    h += opt_ext(delta, p + h);
+    h += opt_ext(value_len, p + h);
+    memcpy(p + h, value, value_len);
+
+    *last = number;
+    return n + h + value_len;
+}
+
+static bool opt_get(const uint8_t** p, const uint8_t* end, uint8_t nibble, uint32_t* value) {
+    if (nibble < 13) {
+        *value = nibble;
+    } else if ((nibble == 13) && (*p + 1 <= end)) {
+        *value = 13 + (*p)[0];
+        *p += 1;
+    } else if ((nibble == 14) && (*p + 2 <= end)) {
+        *value = 269 + (((*p)[0] << 8) | (*p)[1]);
+        *p += 2;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static uint32_t opt_uint(const uint8_t* value, size_t len) {
+    uint32_t v = 0;
+    for (size_t i = 0; i < len; i++) {
+        v = (v << 8) | value[i];
+    }
+    return v;
+}
+
+/**
+ * @brief   Encode a CoAP message.
+ *
+ * @param[in] msg   message, path segments are separated by '/'
+ * @param[out] buf  output buffer
+ * @param[in] len   output buffer size
+ * @return          encoded length, 0 if the buffer is too small
+ *
+ */
+size_t app_coap_encode(const app_coap_msg_t* msg, uint8_t* buf, size_t len) {
+    if ((msg->token_len > APP_COAP_TOKEN_MAX) || (len < 4 + (size_t)msg->token_len)) {
+        return 0;
+    }
+
+    buf[0] = (uint8_t)((COAP_VERSION << 6) | ((msg->type & 0x3) << 4) | msg->token_len);
+    buf[1] = msg->code;
+    buf[2] = (uint8_t)(msg->mid >> 8);
+    buf[3] = (uint8_t)msg->mid;
+    memcpy(buf + 4, msg->token, msg->token_len);
+
+    size_t   n    = 4 + msg->token_len;
+    uint16_t last = 0;
+
+    const char* segment = msg->path;
+    while (*segment != '\0') {
+        const char* end = strchr(segment, '/');
+        size_t      seg = end ? (size_t)(end - segment) : strlen(segment);
+        if (seg > 0) {
+            n = opt_put(buf, len, n, &last, OPT_URI_PATH, segment, seg);
+        }
+        segment += seg + (end ? 1 : 0);
+    }
+
+    if (msg->format >= 0) {
+        uint8_t format[2] = {(uint8_t)(msg->format >> 8), (uint8_t)msg->format};
+        size_t  flen      = (msg->format == 0) ? 0 : (msg->format < 256) ? 1 : 2;
+        n                 = opt_put(buf, len, n, &last, OPT_CONTENT_FORMAT, format + 2 - flen, flen);
+    }
+
+    if (msg->no_response) {
+        uint8_t value = NO_RESPONSE_2XX;
+        n             = opt_put(buf, len, n, &last, OPT_NO_RESPONSE, &value, 1);
+    }
+
+    if (msg->payload_len > 0) {
+        if ((n == 0) || (n + 1 + msg->payload_len > len)) {
+            return 0;
+        }
+        buf[n++] = PAYLOAD_MARKER;
+        memcpy(buf + n, msg->payload, msg->payload_len);
+        n += msg->payload_len;
+    }
+
+    return n;
+}
+
+/**
+ * @brief   Decode a CoAP message.
+ * @note    Unknown options are skipped, the payload points into buf.
+ *
+ * @param[in] buf   received datagram
+ * @param[in] len   received datagram length
+ * @param[out] msg  decoded message
+ * @return          retrun true if the datagram is a well formed CoAP message
+ *
+ */
+bool app_coap_decode(const uint8_t* buf, size_t len, app_coap_msg_t* msg) {
+    memset(msg, 0, sizeof(app_coap_msg_t));
+    msg->format = APP_COAP_NO_FORMAT;
+
+    if ((len < 4) || ((buf[0] >> 6) != COAP_VERSION) || ((buf[0] & 0xf) > APP_COAP_TOKEN_MAX)) {
+        return false;
+    }
+
+    msg->type      = (buf[0] >> 4) & 0x3;
+    msg->token_len = buf[0] & 0xf;
+    msg->code      = buf[1];
+    msg->mid       = (uint16_t)((buf[2] << 8) | buf[3]);
+    if (len < 4 + (size_t)msg->token_len) {
+        return false;
+    }
+    memcpy(msg->token, buf + 4, msg->token_len);
+
+    const uint8_t* p      = buf + 4 + msg->token_len;
+    const uint8_t* end    = buf + len;
+    uint32_t       number = 0;
+    size_t         path   = 0;
+    while ((p < end) && (*p != PAYLOAD_MARKER)) {
+        uint8_t  header = *p++;
+        uint32_t delta, value_len;
+        if (!opt_get(&p, end, header >> 4, &delta) || !opt_get(&p, end, header & 0xf, &value_len) ||
+            (p + value_len > end)) {
+            return false;
+        }
+        number += delta;
+
+        if (number == OPT_URI_PATH) {
+            if (path + value_len + 2 > APP_COAP_PATH_MAX) {
+                return false;
+            }
+            if (path > 0) {
+                msg->path[path++] = '/';
+            }
+            memcpy(msg->path + path, p, value_len);
+            path += value_len;
+        } else if ((number == OPT_CONTENT_FORMAT) && (value_len <= 2)) {
+            msg->format = (int16_t)opt_uint(p, value_len);
+        } else if (number == OPT_NO_RESPONSE) {
+            msg->no_response = (opt_uint(p, value_len) & NO_RESPONSE_2XX) != 0;
+        }
+        p += value_len;
+    }
+    msg->path[path] = '\0';
+
+    if (p < end) {
+        // a payload marker followed by an empty payload is a format error
+        if (p + 1 == end) {
+            return false;
+        }
+        msg->payload     = p + 1;
+        msg->payload_len = (size_t)(end - p - 1);
+    }
+
+    return true;
+}
+
+/** @} */
@@ -0,0 +1,221 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_config.c
+ * @brief   Runtime configuration.
+ * @author  ael-mess
+ *
+ * @addtogroup IN
+ * @{
+ */
+
+#include "string.h"
+
+#include "sdkconfig.h"
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_wifi.h"
+#include "cJSON.h"
+
+#include "freertos/FreeRTOS.h"
+
+#include "app_config.h"
+#include "app_nvs.h"
+#include "app_wifi.h"
+
+#include "app_log.h"
+#if CONFIG_ENABLE_LOGGING
+static const char* TAG = "app-config";
+#endif
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define PUBLISH_INTERVAL  CONFIG_PUBLISH_INTERVAL
+#define PUBLISH_BATCH     CONFIG_PUBLISH_BATCH
+#define PUBLISH_MIN_MS    100
+#define PUBLISH_MAX_MS    3600000
+#define PUBLISH_MAX_BATCH CONFIG_PUBLISH_MAX_BATCH
+#define DEADBAND_MAX      1000
+#define HEARTBEAT_MAX_S   86400
+#define COMMAND_MAX_SIZE  256
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static portMUX_TYPE m_lock = portMUX_INITIALIZER_UNLOCKED;
+static app_config_t m_config;
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static void config_defaults(app_config_t* config) {
+    memset(config, 0, sizeof(app_config_t));
+    config->schema      = APP_CONFIG_SCHEMA;
+    config->version     = 0;
+    config->publish_ms  = PUBLISH_INTERVAL;
+    config->batch_size  = PUBLISH_BATCH;
+    config->power_mode  = WIFI_PS_NONE;
+    config->log_level   = CONFIG_LOG_DEFAULT_LEVEL;
+    config->deadband    = CONFIG_PUBLISH_DEADBAND;
+    config->min_ms      = CONFIG_PUBLISH_MIN_SPACING;
+    config->heartbeat_s = CONFIG_PUBLISH_HEARTBEAT;
+}
+
+static bool config_is_valid(const app_config_t* config) {
+    return (config->schema == APP_CONFIG_SCHEMA) && (config->publish_ms >= PUBLISH_MIN_MS) &&
+           (config->publish_ms <= PUBLISH_MAX_MS) && (config->batch_size >= 1) &&
+           (config->batch_size <= PUBLISH_MAX_BATCH) && (config->power_mode <= WIFI_PS_MAX_MODEM) &&
+           (config->log_level <= ESP_LOG_VERBOSE) && (config->deadband <= DEADBAND_MAX) &&
+           (config->heartbeat_s >= 1) && (config->heartbeat_s <= HEARTBEAT_MAX_S) &&
+           (config->min_ms <= config->heartbeat_s * 1000);
+}
+
+static void config_side_effects(const app_config_t* config) {
+    esp_log_level_set("*", (esp_log_level_t)config->log_level);
+#if CONFIG_RELAY_GATEWAY
+    // leaf frames are missed while the modem sleeps
+    app_wifi_set_ps(WIFI_PS_NONE);
+#else
+    app_wifi_set_ps(config->power_mode);
+#endif
+}
+
+static bool json_get_uint(const cJSON* root, const char* name, uint32_t max, uint32_t* value, bool* valid) {
+    const cJSON* item = cJSON_GetObjectItem(root, name);
+    if (item == NULL) {
+        return false;
+    }
+    if (!cJSON_IsNumber(item) || (item->valuedouble < 0) || (item->valuedouble > max)) {
+        *valid = false;
+        return false;
+    }
+    *value = (uint32_t)item->valuedouble;
+    return true;
+}
+
+/**
+ * @brief   Load configuration.
+ * @note    Falls back to Kconfig defaults when no valid configuration is stored.
+ *
+ */
+void app_config_init(void) {
+    app_config_t config;
+    if ((app_nvs_get_config(&config, sizeof(config)) != ESP_OK) || !config_is_valid(&config)) {
+        RTN_LOGI(TAG, "Using default configuration");
+        config_defaults(&config);
+    }
+
+    portENTER_CRITICAL(&m_lock);
+    m_config = config;
+    portEXIT_CRITICAL(&m_lock);
+
+    config_side_effects(&config);
+    RTN_LOGI(TAG, "Configuration v%u: sample %u ms, batch %u, power %u, log %u, deadband %u, spacing %u ms, "
+             "heartbeat %u s", config.version, config.publish_ms, config.batch_size, config.power_mode,
+             config.log_level, config.deadband, config.min_ms, config.heartbeat_s);
+}
+
+/**
+ * @brief   Configuration getter.
+ *
+ * @param[out] config   configuration snapshot
+ *
+ */
+void app_config_get(app_config_t* config) {
+    portENTER_CRITICAL(&m_lock);
+    *config = m_config;
+    portEXIT_CRITICAL(&m_lock);
+}
+
+/**
+ * @brief   Apply a configuration command.
+ * @note    Command format: { "schema": 2, "version": 2, "publish_ms": 1000, "batch": 1, "power": 0, "log": 3,
+ *          "deadband": 1, "min_ms": 1000, "heartbeat_s": 900 }.
+ *          Omitted fields keep their value. The command is applied only if all fields are valid and
+ *          its version is newer than the applied one.
+ *
+ * @param[in] data      JSON command
+ * @param[in] length    JSON command length
+ * @param[out] reason   rejection reason
+ * @return              retrun msg
+ *
+ */
+esp_err_t app_config_apply_json(const char* data, int length, const char** reason) {
+    char command[COMMAND_MAX_SIZE];
+    if ((length <= 0) || (length >= COMMAND_MAX_SIZE)) {
+        *reason = "bad length";
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(command, data, length);
+    command[length] = '\0';
+
+    cJSON* root = cJSON_Parse(command);
+    if (root == NULL) {
+        *reason = "bad json";
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    app_config_t config;
+    app_config_get(&config);
+    uint32_t current = config.version;
+
+    bool     valid  = true;
+    uint32_t schema = 0;
+    uint32_t value  = 0;
+    if (!json_get_uint(root, "schema", UINT16_MAX, &schema, &valid) || (schema != APP_CONFIG_SCHEMA)) {
+        valid = false;
+    }
+    if (!json_get_uint(root, "version", UINT32_MAX, &config.version, &valid)) {
+        valid = false;
+    }
+    if (json_get_uint(root, "publish_ms", PUBLISH_MAX_MS, &value, &valid)) {
+        config.publish_ms = value;
+    }
+    if (json_get_uint(root, "batch", PUBLISH_MAX_BATCH, &value, &valid)) {
+        config.batch_size = value;
+    }
+    if (json_get_uint(root, "power", WIFI_PS_MAX_MODEM, &value, &valid)) {
+        config.power_mode = value;
+    }
+    if (json_get_uint(root, "log", ESP_LOG_VERBOSE, &value, &valid)) {
+        config.log_level = value;
+    }
+    if (json_get_uint(root, "deadband", DEADBAND_MAX, &value, &valid)) {
+        config.deadband = value;
+    }
+    if (json_get_uint(root, "min_ms", PUBLISH_MAX_MS, &value, &valid)) {
+        config.min_ms = value;
+    }
+    if (json_get_uint(root, "heartbeat_s", HEARTBEAT_MAX_S, &value, &valid)) {
+        config.heartbeat_s = value;
+    }
+    cJSON_Delete(root);
+
+    if (!valid || !config_is_valid(&config)) {
+        *reason = "invalid field";
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (config.version <= current) {
+        *reason = "stale version";
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    // persist first, so that a reset never reverts to an older configuration than the acknowledged one
+    if (app_nvs_set_config(&config, sizeof(config)) != ESP_OK) {
+        *reason = "storage failure";
+        return ESP_FAIL;
+    }
+
+    portENTER_CRITICAL(&m_lock);
+    m_config = config;
+    portEXIT_CRITICAL(&m_lock);
+
+    config_side_effects(&config);
+    RTN_LOGI(TAG, "Configuration v%u applied", config.version);
+
+    *reason = NULL;
+    return ESP_OK;
+}
+
+/** @} */
@@ -0,0 +1,133 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_espnow.c
+ * @brief   ESP-NOW relay link.
+ * @note    Frames received in the WiFi task are copied to a queue and read
+ *          back by the relay poll, a full queue drops them as the air would.
+ *          Peers are added on first send, unencrypted, on the current channel
+ *          of the station interface.
+ * @author  ael-mess
+ *
+ * @addtogroup NET
+ * @{
+ */
+
+#include "string.h"
+
+#include "esp_system.h"
+#include "esp_now.h"
+#include "esp_wifi.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#include "app_espnow.h"
+
+#include "app_log.h"
+#if CONFIG_ENABLE_LOGGING
+static const char* TAG = "app-espnow";
+#endif
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#if CONFIG_RELAY_GATEWAY
+#define RX_QUEUE_LEN (2 * APP_RELAY_MAX_LEAVES) /* a frame in flight per leaf, and its retransmission */
+#else
+#define RX_QUEUE_LEN 4
+#endif
+
+typedef struct {
+    uint8_t mac[6];
+    uint8_t len;
+    uint8_t data[APP_RELAY_FRAME_SIZE];
+} frame_t;
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static StaticQueue_t     m_rx_queue;
+static uint8_t           m_rx_storage[RX_QUEUE_LEN * sizeof(frame_t)];
+static QueueHandle_t     m_rx;
+static volatile uint32_t m_dropped;
+static uint32_t          m_dropped_seen;
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static void on_recv(const uint8_t* mac, const uint8_t* data, int len) {
+    // WiFi task, no blocking
+    frame_t frame;
+    if ((len <= 0) || (len > APP_RELAY_FRAME_SIZE)) {
+        m_dropped++;
+        return;
+    }
+    memcpy(frame.mac, mac, 6);
+    memcpy(frame.data, data, len);
+    frame.len = (uint8_t)len;
+    if (xQueueSend(m_rx, &frame, 0) != pdTRUE) {
+        m_dropped++;
+    }
+}
+
+static int espnow_send(void* ctx, const uint8_t peer[6], const uint8_t* data, size_t len) {
+    if (!esp_now_is_peer_exist(peer)) {
+        esp_now_peer_info_t info;
+        memset(&info, 0, sizeof(info));
+        memcpy(info.peer_addr, peer, 6);
+        info.channel = 0; /* current channel */
+        info.ifidx   = ESP_IF_WIFI_STA;
+        info.encrypt = false;
+        if (esp_now_add_peer(&info) != ESP_OK) {
+            RTN_LOGW(TAG, "Cannot add peer " MACSTR, MAC2STR(peer));
+            return -1;
+        }
+    }
+
+    return (esp_now_send(peer, data, len) == ESP_OK) ? 0 : -1;
+}
+
+static int espnow_recv(void* ctx, uint8_t peer[6], uint8_t* data, size_t len) {
+    uint32_t dropped = m_dropped;
+    if (dropped != m_dropped_seen) {
+        RTN_LOGW(TAG, "%u frames dropped", dropped - m_dropped_seen);
+        m_dropped_seen = dropped;
+    }
+
+    frame_t frame;
+    if ((xQueueReceive(m_rx, &frame, 0) != pdTRUE) || (frame.len > len)) {
+        return 0;
+    }
+    memcpy(peer, frame.mac, 6);
+    memcpy(data, frame.data, frame.len);
+    return frame.len;
+}
+
+/**
+ * @brief   Initialize ESP-NOW relay link.
+ * @note    WiFi must be started.
+ *
+ * @param[out] link relay link operations
+ * @return          retrun msg
+ *
+ */
+esp_err_t app_espnow_init(app_relay_link_t* link) {
+    RTN_LOGI(TAG, "Initializing ESP-NOW ..");
+
+    m_rx = xQueueCreateStatic(RX_QUEUE_LEN, sizeof(frame_t), m_rx_storage, &m_rx_queue);
+
+    esp_err_t err = esp_now_init();
+    if (err != ESP_OK) {
+        RTN_LOGE(TAG, "Cannot initialize ESP-NOW");
+        return err;
+    }
+    ESP_ERROR_CHECK(esp_now_register_recv_cb(on_recv));
+
+    link->send = espnow_send;
+    link->recv = espnow_recv;
+    link->ctx  = NULL;
+    return ESP_OK;
+}
+
+/** @} */
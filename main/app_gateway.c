@@ -0,0 +1,141 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_gateway.c
+ * @brief   ESP-NOW gateway.
+ * @note    Takes the counter records of nearby leaves over ESP-NOW (app_relay)
+ *          and publishes them upstream in batches, on the uplink transport of
+ *          the device. The radio stays on the channel of the AP the gateway is
+ *          associated with, leaves are set to the same one, and the power save
+ *          stays off (app_config) so that frames are not missed between beacons.
+ *          The leaves are acknowledged once the broker acknowledges the batch
+ *          (PUBACK), the reports go from the MQTT task to the publishing task
+ *          through a queue.
+ * @author  ael-mess
+ *
+ * @addtogroup NET
+ * @{
+ */
+
+#include "esp_system.h"
+#include "esp_wifi.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#include "app_gateway.h"
+#include "app_espnow.h"
+#include "app_relay.h"
+#include "app_transport.h"
+#include "app_time.h"
+
+#include "app_log.h"
+#if CONFIG_ENABLE_LOGGING
+static const char* TAG = "app-gateway";
+#endif
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#if CONFIG_RELAY_GATEWAY
+#define BATCH    CONFIG_RELAY_BATCH
+#define DELAY_MS CONFIG_RELAY_MAX_DELAY_MS
+#else
+#define BATCH    APP_RELAY_MAX_BATCH
+#define DELAY_MS 1000
+#endif
+
+#if CONFIG_TRANSPORT_MQTT
+#define INFLIGHT_WINDOW CONFIG_MQTT_INFLIGHT_WINDOW
+#define REPORT_MS       (2 * CONFIG_MQTT_INFLIGHT_EXPIRE) /* past the MQTT expiry, a handoff publishes again */
+#else
+#define INFLIGHT_WINDOW 1
+#define REPORT_MS       60000
+#endif
+
+/* a slot acknowledged within a poll is given again, the reports of one poll are bounded by the pending messages */
+#define REPORT_QUEUE_LEN ((INFLIGHT_WINDOW > APP_RELAY_PENDING) ? INFLIGHT_WINDOW : APP_RELAY_PENDING)
+
+typedef struct {
+    int  token;
+    bool delivered;
+} report_t;
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static app_relay_gateway_t m_gw;
+static bool                m_started;
+static StaticQueue_t       m_report_queue;
+static uint8_t             m_report_storage[REPORT_QUEUE_LEN * sizeof(report_t)];
+static QueueHandle_t       m_reports;
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static void on_report(int token, bool delivered) {
+    // transport task, the gateway state belongs to the publishing task
+    report_t report = {.token = token, .delivered = delivered};
+    if (xQueueSend(m_reports, &report, 0) != pdTRUE) {
+        RTN_LOGE(TAG, "Delivery report %d dropped, the batch expires", token);
+    }
+}
+
+static int publish(void* ctx, const char* data, int* token) {
+    return (app_transport_publish_relay(data, on_report, token) == ESP_OK) ? 0 : -1;
+}
+
+/**
+ * @brief   Initialize ESP-NOW gateway.
+ * @note    WiFi must be started.
+ *
+ * @return  retrun msg
+ *
+ */
+esp_err_t app_gateway_init(void) {
+    uint8_t            channel = 0;
+    wifi_second_chan_t second;
+    esp_wifi_get_channel(&channel, &second);
+    RTN_LOGI(TAG, "Initializing gateway on channel %u ..", channel);
+
+    m_reports = xQueueCreateStatic(REPORT_QUEUE_LEN, sizeof(report_t), m_report_storage, &m_report_queue);
+
+    app_relay_link_t link;
+    esp_err_t        err = app_espnow_init(&link);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    app_relay_gateway_init(&m_gw, &link, publish, NULL, app_time_to_utc, BATCH, DELAY_MS, REPORT_MS);
+    m_started = true;
+    return ESP_OK;
+}
+
+/**
+ * @brief   Take the delivery reports and the leaf records, and publish full or expired batches.
+ * @note    Called periodically from the publishing task.
+ *
+ */
+void app_gateway_poll(void) {
+    if (!m_started) {
+        return;
+    }
+
+    report_t report;
+    while (xQueueReceive(m_reports, &report, 0) == pdTRUE) {
+        app_relay_gateway_report(&m_gw, report.token, report.delivered);
+    }
+    app_relay_gateway_poll(&m_gw, app_time_now());
+}
+
+/**
+ * @brief   Encode gateway statistics record.
+ *
+ * @param[out] buf  output buffer
+ * @param[in] len   output buffer size
+ * @return          encoded length, 0 if not started or the buffer is too small
+ *
+ */
+size_t app_gateway_stats(char* buf, size_t len) { return m_started ? app_relay_gateway_encode(&m_gw, buf, len) : 0; }
+
+/** @} */
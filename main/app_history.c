@@ -0,0 +1,294 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_history.c
+ * @brief   Counter history.
+ * @note    The counter at the end of each minute is kept in the "history" flash
+ *          partition (app_series), once the time is synchronized. Ranges are
+ *          requested over MQTT and sent back in chunks as acknowledged
+ *          messages, each chunk lists the value changes and the minutes
+ *          without data:
+ *          { "id": 7, "from": 1666180800, "to": 1666267199 }
+ *          { "type": "history", "id": 7, "from": 1666180800, "to": 1666184340, "more": true,
+ *            "v": [[0, 3], [5, 4], [12, null], [30, 2]] }
+ *          Offsets are minutes from "from".
+ * @author  ael-mess
+ *
+ * @addtogroup MAIN
+ * @{
+ */
+
+#include "stdio.h"
+#include "string.h"
+
+#include "esp_system.h"
+#include "esp_partition.h"
+#include "esp_spi_flash.h"
+#include "cJSON.h"
+
+#include "freertos/FreeRTOS.h"
+
+#include "app_history.h"
+#include "app_series.h"
+#include "app_time.h"
+#include "app_transport.h"
+
+#include "app_log.h"
+#if CONFIG_ENABLE_LOGGING
+static const char* TAG = "app-history";
+#endif
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define PARTITION_NAME  "history"
+#define PENDING_LEN     8   /* closed minutes awaiting the flash write */
+#define CHUNK_POINTS    60  /* minutes read per chunk */
+#define CHUNKS_PER_POLL 4   /* the in-flight window is shared with the counter records */
+#define REQUEST_SIZE    128
+#define PAIR_SIZE       24  /* max encoded size of one change */
+
+typedef struct {
+    bool     active;
+    uint32_t id;
+    uint32_t next; /* next minute to send */
+    uint32_t to;   /* last minute to send */
+} request_t;
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static portMUX_TYPE       m_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool               m_ready;
+static app_series_t       m_series;
+static uint32_t           m_minute; /* minute being sampled, 0 before the first sample */
+static uint16_t           m_value;
+static app_series_point_t m_pending[PENDING_LEN];
+static size_t             m_pending_head;
+static size_t             m_pending_count;
+static request_t          m_request;
+static app_series_point_t m_points[CHUNK_POINTS];
+static char               m_chunk[128 + (2 * CHUNK_POINTS + 1) * PAIR_SIZE];
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static int partition_read(void* ctx, uint32_t addr, void* buf, size_t len) {
+    return (esp_partition_read(ctx, addr, buf, len) == ESP_OK) ? 0 : -1;
+}
+
+static int partition_write(void* ctx, uint32_t addr, const void* buf, size_t len) {
+    return (esp_partition_write(ctx, addr, buf, len) == ESP_OK) ? 0 : -1;
+}
+
+static int partition_erase(void* ctx, uint32_t addr) {
+    return (esp_partition_erase_range(ctx, addr, SPI_FLASH_SEC_SIZE) == ESP_OK) ? 0 : -1;
+}
+
+static size_t chunk_encode(uint32_t id, uint32_t from, uint32_t to, bool more, const app_series_point_t* points,
+                           size_t count) {
+    size_t   len    = sizeof(m_chunk);
+    uint32_t expect = from;
+    bool     known  = false;
+    uint16_t last   = 0;
+
+    // sized for a gap and a change per point, no pair can overflow
+    int n = snprintf(m_chunk, len,
+                     "{ \"type\": \"history\", \"id\": %u, \"from\": %llu, \"to\": %llu, \"more\": %s, \"v\": [", id,
+                     from * 60ULL, to * 60ULL, more ? "true" : "false");
+    for (size_t i = 0; i < count; i++) {
+        const app_series_point_t* p = &points[i];
+        if (p->minute > expect) {
+            n += sprintf(m_chunk + n, "%s[%u, null]", (expect > from) ? ", " : "", expect - from);
+            known = false;
+        }
+        if (!known || (p->value != last)) {
+            n += sprintf(m_chunk + n, "%s[%u, %u]", (p->minute > from) ? ", " : "", p->minute - from, p->value);
+        }
+        known  = true;
+        last   = p->value;
+        expect = p->minute + 1;
+    }
+    if (expect <= to) {
+        n += sprintf(m_chunk + n, "%s[%u, null]", (expect > from) ? ", " : "", expect - from);
+    }
+    n += sprintf(m_chunk + n, "] }");
+    return (size_t)n;
+}
+
+/**
+ * @brief   Open the history partition.
+ *
+ * @return  retrun msg
+ *
+ */
+esp_err_t app_history_init(void) {
+    const esp_partition_t* partition =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, PARTITION_NAME);
+    if (partition == NULL) {
+        RTN_LOGE(TAG, "No %s partition", PARTITION_NAME);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    app_series_flash_t flash = {
+        .read        = partition_read,
+        .write       = partition_write,
+        .erase       = partition_erase,
+        .ctx         = (void*)partition,
+        .size        = partition->size,
+        .sector_size = SPI_FLASH_SEC_SIZE,
+    };
+    if (app_series_init(&m_series, &flash) != 0) {
+        RTN_LOGE(TAG, "History partition not usable");
+        return ESP_FAIL;
+    }
+
+    RTN_LOGI(TAG, "History of %u blocks, %u in use", m_series.blocks, m_series.count);
+    m_ready = true;
+    return ESP_OK;
+}
+
+/**
+ * @brief   Record a counter sample.
+ * @note    Called on every sample, the last sample of a minute is stored once
+ *          the next minute starts.
+ *
+ * @param[in] mono_us   sample time, monotonic clock
+ * @param[in] count     sampled counter
+ *
+ */
+void app_history_sample(int64_t mono_us, uint16_t count) {
+    int64_t utc_ms;
+    if (!m_ready || !app_time_to_utc(mono_us, &utc_ms)) {
+        return;
+    }
+
+    uint32_t minute = (uint32_t)(utc_ms / 60000);
+    portENTER_CRITICAL(&m_lock);
+    if ((m_minute != 0) && (minute != m_minute)) {
+        // the publishing task blocked for minutes, the oldest one is lost
+        if (m_pending_count == PENDING_LEN) {
+            m_pending_head = (m_pending_head + 1) % PENDING_LEN;
+            m_pending_count--;
+        }
+        app_series_point_t* p = &m_pending[(m_pending_head + m_pending_count++) % PENDING_LEN];
+        p->minute             = m_minute;
+        p->value              = m_value;
+    }
+    m_minute = minute;
+    m_value  = count;
+    portEXIT_CRITICAL(&m_lock);
+}
+
+/**
+ * @brief   Request a history range.
+ * @note    A request replaces the one being served.
+ *
+ * @param[in] data      JSON request, "id", "from" and "to" in UTC seconds
+ * @param[in] length    request length
+ * @return              retrun msg
+ *
+ */
+esp_err_t app_history_request(const char* data, int length) {
+    char request[REQUEST_SIZE];
+    if ((length <= 0) || (length >= REQUEST_SIZE)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(request, data, length);
+    request[length] = '\0';
+
+    cJSON* root = cJSON_Parse(request);
+    if (root == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const cJSON* id   = cJSON_GetObjectItem(root, "id");
+    const cJSON* from = cJSON_GetObjectItem(root, "from");
+    const cJSON* to   = cJSON_GetObjectItem(root, "to");
+    bool valid = cJSON_IsNumber(id) && cJSON_IsNumber(from) && cJSON_IsNumber(to) && (from->valuedouble >= 0) &&
+                 (to->valuedouble >= from->valuedouble);
+
+    request_t r = {0};
+    if (valid) {
+        r.active = true;
+        r.id     = (uint32_t)id->valuedouble;
+        r.next   = (uint32_t)(from->valuedouble / 60);
+        r.to     = (uint32_t)(to->valuedouble / 60);
+    }
+    cJSON_Delete(root);
+    if (!valid) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    RTN_LOGI(TAG, "History request %u, %u minutes", r.id, r.to - r.next + 1);
+    portENTER_CRITICAL(&m_lock);
+    m_request = r;
+    portEXIT_CRITICAL(&m_lock);
+    return ESP_OK;
+}
+
+/**
+ * @brief   Store the closed minutes and send the requested range.
+ * @note    Called from the publishing task, the only one reaching the store.
+ *
+ */
+void app_history_poll(void) {
+    if (!m_ready) {
+        return;
+    }
+
+    while (true) {
+        app_series_point_t point;
+        portENTER_CRITICAL(&m_lock);
+        bool pending = (m_pending_count > 0);
+        if (pending) {
+            point          = m_pending[m_pending_head];
+            m_pending_head = (m_pending_head + 1) % PENDING_LEN;
+            m_pending_count--;
+        }
+        portEXIT_CRITICAL(&m_lock);
+        if (!pending) {
+            break;
+        }
+        app_series_append(&m_series, point.minute, point.value);
+    }
+
+    for (int i = 0; i < CHUNKS_PER_POLL; i++) {
+        request_t r;
+        portENTER_CRITICAL(&m_lock);
+        r = m_request;
+        portEXIT_CRITICAL(&m_lock);
+        if (!r.active) {
+            break;
+        }
+
+        size_t   n    = app_series_query(&m_series, r.next, r.to, m_points, CHUNK_POINTS);
+        bool     more = (n == CHUNK_POINTS) && (m_points[n - 1].minute < r.to);
+        uint32_t end  = more ? m_points[n - 1].minute : r.to;
+        chunk_encode(r.id, r.next, end, more, m_points, n);
+        // a full window or a lost connection sends the same chunk again on the next poll
+        if (app_transport_publish_history(m_chunk) != ESP_OK) {
+            break;
+        }
+
+        portENTER_CRITICAL(&m_lock);
+        if ((m_request.id == r.id) && (m_request.next == r.next)) {
+            m_request.next   = end + 1;
+            m_request.active = more;
+        }
+        portEXIT_CRITICAL(&m_lock);
+    }
+}
+
+/**
+ * @brief   Encode history statistics record.
+ *
+ * @param[out] buf      output buffer
+ * @param[in] len       output buffer size
+ * @return              encoded length, 0 if the buffer is too small or the history is not available
+ *
+ */
+size_t app_history_stats(char* buf, size_t len) {
+    return m_ready ? app_series_encode(&m_series, buf, len) : 0;
+}
+
+/** @} */
@@ -0,0 +1,378 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_http.c
+ * @brief   Local HTTP query API.
+ * @note    Plain BSD sockets (lwIP on target, the host stack otherwise), a
+ *          single select loop over a fixed connection table, no heap use.
+ *          Routes:
+ *          - GET /count              current counter
+ *          - GET /count?since=<seq>  long-poll, answers once the counter differs from seq
+ *          - GET /history            last counter changes
+ *          - GET /events             server-sent events stream of counter changes
+ * @author  ael-mess
+ *
+ * @addtogroup NET
+ * @{
+ */
+
+#include "errno.h"
+#include "fcntl.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "unistd.h"
+
+#include "sys/select.h"
+#include "sys/socket.h"
+#include "netinet/in.h"
+#include "arpa/inet.h"
+
+#include "app_http.h"
+#include "app_live.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define REQUEST_SIZE       512
+#define REQUEST_TIMEOUT_US 5000000
+#define BODY_OFFSET        192 /* room for the status line and headers */
+#define RECORD_SIZE        64  /* max encoded size of one record */
+#define TX_SIZE            (BODY_OFFSET + 32 + APP_LIVE_HISTORY * RECORD_SIZE)
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// socket budget: the listen socket, the wake pair and the clients here, one per MQTT session or the CoAP socket
+#if CONFIG_MQTT_STANDBY
+#define UPLINK_SOCKETS 2
+#else
+#define UPLINK_SOCKETS 1
+#endif
+#if defined(CONFIG_LWIP_MAX_SOCKETS) && (3 + APP_HTTP_MAX_CLIENTS + UPLINK_SOCKETS > CONFIG_LWIP_MAX_SOCKETS)
+#error "HTTP_MAX_CLIENTS and the uplink sockets exceed LWIP_MAX_SOCKETS"
+#endif
+
+typedef enum {
+    CONN_FREE = 0,
+    CONN_REQUEST,  /* waiting for the request headers */
+    CONN_LONGPOLL, /* waiting for a counter change */
+    CONN_STREAM,   /* server-sent events */
+} conn_state_t;
+
+typedef struct {
+    int          fd;
+    conn_state_t state;
+    uint32_t     since;
+    int64_t      deadline_us;
+    uint16_t     rx_len;
+    char         rx[REQUEST_SIZE];
+} conn_t;
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static int                m_listen  = -1;
+static int                m_wake    = -1; /* loopback UDP socket waking up the select loop */
+static int                m_wake_tx = -1;
+static struct sockaddr_in m_wake_addr;
+static conn_t             m_conns[APP_HTTP_MAX_CLIENTS];
+static uint32_t           m_sent_seq;
+static app_http_now_t     m_now;
+static app_http_clock_t   m_clock;
+
+static char         m_tx[TX_SIZE];
+static app_record_t m_records[APP_LIVE_HISTORY];
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static int set_nonblocking(int fd) { return fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK); }
+
+static void conn_close(conn_t* conn) {
+    close(conn->fd);
+    conn->fd    = -1;
+    conn->state = CONN_FREE;
+}
+
+static bool send_all(conn_t* conn, const char* data, size_t len) {
+    // responses fit in the socket send buffer, a client unable to take them is dropped
+    while (len > 0) {
+        ssize_t sent = send(conn->fd, data, len, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            conn_close(conn);
+            return false;
+        }
+        data += sent;
+        len -= sent;
+    }
+    return true;
+}
+
+static int encode_record(char* buf, size_t len, const app_record_t* record) {
+    int64_t ts     = record->mono_us / 1000;
+    bool    synced = m_clock ? m_clock(record->mono_us, &ts) : false;
+    return snprintf(buf, len, "{\"value\":%u,\"ts\":%lld,\"sync\":%s}", record->count, (long long)ts,
+                    synced ? "true" : "false");
+}
+
+static int encode_current(char* buf, size_t len) {
+    app_record_t record;
+    uint32_t     seq;
+    if (!app_live_current(&record, &seq)) {
+        return snprintf(buf, len, "{\"seq\":0}");
+    }
+
+    int n = snprintf(buf, len, "{\"seq\":%u,\"record\":", (unsigned)seq);
+    n += encode_record(buf + n, len - n, &record);
+    n += snprintf(buf + n, len - n, "}");
+    return n;
+}
+
+static int encode_history(char* buf, size_t len) {
+    size_t count = app_live_history(m_records, APP_LIVE_HISTORY);
+
+    int n = snprintf(buf, len, "{\"records\":[");
+    for (size_t i = 0; i < count; i++) {
+        n += snprintf(buf + n, len - n, i ? "," : "");
+        n += encode_record(buf + n, len - n, &m_records[i]);
+    }
+    n += snprintf(buf + n, len - n, "]}");
+    return n;
+}
+
+static void respond(conn_t* conn, const char* status, int body_len) {
+    // headers are written right before the body, both leave in one send
+    char header[BODY_OFFSET];
+    int  n = snprintf(header, sizeof(header),
+                      "HTTP/1.1 %s\r\nContent-Type: application/json\r\nContent-Length: %d\r\n"
+                      "Access-Control-Allow-Origin: *\r\nConnection: close\r\n\r\n",
+                      status, body_len);
+
+    char* start = m_tx + BODY_OFFSET - n;
+    memcpy(start, header, n);
+    if (send_all(conn, start, n + body_len)) {
+        conn_close(conn);
+    }
+}
+
+static void respond_current(conn_t* conn) {
+    respond(conn, "200 OK", encode_current(m_tx + BODY_OFFSET, TX_SIZE - BODY_OFFSET));
+}
+
+static void stream_event(conn_t* conn) {
+    int n = snprintf(m_tx, TX_SIZE, "data: ");
+    n += encode_current(m_tx + n, TX_SIZE - n);
+    n += snprintf(m_tx + n, TX_SIZE - n, "\n\n");
+    send_all(conn, m_tx, n);
+}
+
+static void handle_request(conn_t* conn) {
+    char* path = conn->rx + 4;
+    if (strncmp(conn->rx, "GET ", 4) != 0) {
+        respond(conn, "405 Method Not Allowed", 0);
+        return;
+    }
+    char* end = strchr(path, ' ');
+    if (end != NULL) {
+        *end = '\0';
+    }
+
+    app_record_t record;
+    uint32_t     seq;
+    if (!strcmp(path, "/count")) {
+        respond_current(conn);
+    } else if (!strncmp(path, "/count?since=", 13)) {
+        conn->since = strtoul(path + 13, NULL, 10);
+        if (app_live_current(&record, &seq) && (seq != conn->since)) {
+            respond_current(conn);
+        } else {
+            conn->state       = CONN_LONGPOLL;
+            conn->deadline_us = m_now() + APP_HTTP_LONGPOLL_MS * 1000LL;
+        }
+    } else if (!strcmp(path, "/history")) {
+        respond(conn, "200 OK", encode_history(m_tx + BODY_OFFSET, TX_SIZE - BODY_OFFSET));
+    } else if (!strcmp(path, "/events")) {
+        static const char header[] = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+                                     "Access-Control-Allow-Origin: *\r\nConnection: keep-alive\r\n\r\n";
+        if (send_all(conn, header, sizeof(header) - 1)) {
+            conn->state = CONN_STREAM;
+            stream_event(conn);
+        }
+    } else {
+        respond(conn, "404 Not Found", 0);
+    }
+}
+
+static void conn_accept(void) {
+    int fd = accept(m_listen, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+
+    for (int i = 0; i < APP_HTTP_MAX_CLIENTS; i++) {
+        if (m_conns[i].state == CONN_FREE) {
+            set_nonblocking(fd);
+            m_conns[i].fd          = fd;
+            m_conns[i].state       = CONN_REQUEST;
+            m_conns[i].rx_len      = 0;
+            m_conns[i].deadline_us = m_now() + REQUEST_TIMEOUT_US;
+            return;
+        }
+    }
+    close(fd);
+}
+
+static void conn_read(conn_t* conn) {
+    if (conn->state != CONN_REQUEST) {
+        // nothing expected once the request is parsed, only detect the peer closing
+        char    drain[32];
+        ssize_t len = recv(conn->fd, drain, sizeof(drain), 0);
+        if ((len == 0) || ((len < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK))) {
+            conn_close(conn);
+        }
+        return;
+    }
+
+    ssize_t len = recv(conn->fd, conn->rx + conn->rx_len, REQUEST_SIZE - 1 - conn->rx_len, 0);
+    if (len <= 0) {
+        if ((len == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK))) {
+            conn_close(conn);
+        }
+        return;
+    }
+    conn->rx_len += len;
+    conn->rx[conn->rx_len] = '\0';
+
+    if (strstr(conn->rx, "\r\n\r\n") != NULL) {
+        handle_request(conn);
+    } else if (conn->rx_len >= REQUEST_SIZE - 1) {
+        respond(conn, "431 Request Header Fields Too Large", 0);
+    }
+}
+
+/**
+ * @brief   Initialize HTTP server.
+ *
+ * @param[in] port  TCP port
+ * @param[in] now   monotonic clock in microseconds
+ * @param[in] clock monotonic to UTC conversion, NULL to report time since boot
+ * @return          0 on success, -1 on socket error
+ *
+ */
+int app_http_init(uint16_t port, app_http_now_t now, app_http_clock_t clock) {
+    m_now   = now;
+    m_clock = clock;
+    for (int i = 0; i < APP_HTTP_MAX_CLIENTS; i++) {
+        m_conns[i].fd    = -1;
+        m_conns[i].state = CONN_FREE;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    int reuse = 1;
+    m_listen  = socket(AF_INET, SOCK_STREAM, 0);
+    if ((m_listen < 0) || (setsockopt(m_listen, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0) ||
+        (bind(m_listen, (struct sockaddr*)&addr, sizeof(addr)) < 0) || (listen(m_listen, APP_HTTP_MAX_CLIENTS) < 0)) {
+        return -1;
+    }
+    set_nonblocking(m_listen);
+
+    memset(&m_wake_addr, 0, sizeof(m_wake_addr));
+    m_wake_addr.sin_family      = AF_INET;
+    m_wake_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    socklen_t addr_len = sizeof(m_wake_addr);
+    m_wake             = socket(AF_INET, SOCK_DGRAM, 0);
+    m_wake_tx          = socket(AF_INET, SOCK_DGRAM, 0);
+    if ((m_wake < 0) || (m_wake_tx < 0) || (bind(m_wake, (struct sockaddr*)&m_wake_addr, sizeof(m_wake_addr)) < 0) ||
+        (getsockname(m_wake, (struct sockaddr*)&m_wake_addr, &addr_len) < 0)) {
+        return -1;
+    }
+    set_nonblocking(m_wake);
+
+    return 0;
+}
+
+/**
+ * @brief   Wake up the server on a counter change.
+ * @note    Called from the task updating the live counter.
+ *
+ */
+void app_http_notify(void) {
+    if (m_wake_tx >= 0) {
+        sendto(m_wake_tx, "", 1, 0, (struct sockaddr*)&m_wake_addr, sizeof(m_wake_addr));
+    }
+}
+
+/**
+ * @brief   Serve HTTP clients.
+ * @note    Runs one select iteration, call it in a loop.
+ *
+ * @param[in] timeout_ms    maximum wait without activity
+ *
+ */
+void app_http_poll(int timeout_ms) {
+    int64_t now_us     = m_now();
+    int64_t timeout_us = timeout_ms * 1000LL;
+
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(m_listen, &fds);
+    FD_SET(m_wake, &fds);
+    int max_fd = (m_listen > m_wake) ? m_listen : m_wake;
+    for (int i = 0; i < APP_HTTP_MAX_CLIENTS; i++) {
+        conn_t* conn = &m_conns[i];
+        if (conn->state == CONN_FREE) {
+            continue;
+        }
+        FD_SET(conn->fd, &fds);
+        max_fd = (conn->fd > max_fd) ? conn->fd : max_fd;
+        if ((conn->state != CONN_STREAM) && (conn->deadline_us - now_us < timeout_us)) {
+            timeout_us = (conn->deadline_us > now_us) ? conn->deadline_us - now_us : 0;
+        }
+    }
+
+    struct timeval tv = {.tv_sec = timeout_us / 1000000, .tv_usec = timeout_us % 1000000};
+    if (select(max_fd + 1, &fds, NULL, NULL, &tv) < 0) {
+        return;
+    }
+
+    if (FD_ISSET(m_wake, &fds)) {
+        char drain[16];
+        while (recv(m_wake, drain, sizeof(drain), 0) > 0) {
+        }
+    }
+    if (FD_ISSET(m_listen, &fds)) {
+        conn_accept();
+    }
+    for (int i = 0; i < APP_HTTP_MAX_CLIENTS; i++) {
+        if ((m_conns[i].state != CONN_FREE) && FD_ISSET(m_conns[i].fd, &fds)) {
+            conn_read(&m_conns[i]);
+        }
+    }
+
+    app_record_t record;
+    uint32_t     seq     = 0;
+    bool         changed = app_live_current(&record, &seq) && (seq != m_sent_seq);
+    m_sent_seq           = seq;
+
+    now_us = m_now();
+    for (int i = 0; i < APP_HTTP_MAX_CLIENTS; i++) {
+        conn_t* conn = &m_conns[i];
+        if ((conn->state == CONN_STREAM) && changed) {
+            stream_event(conn);
+        } else if ((conn->state == CONN_LONGPOLL) && ((seq != conn->since) || (now_us >= conn->deadline_us))) {
+            respond_current(conn);
+        } else if ((conn->state == CONN_REQUEST) && (now_us >= conn->deadline_us)) {
+            conn_close(conn);
+        }
+    }
+}
+
+/** @} */
@@ -0,0 +1,109 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_leaf.c
+ * @brief   ESP-NOW leaf uplink.
+ * @note    Counter records are relayed to the gateway over ESP-NOW (app_relay),
+ *          no association nor connection is kept. Only the counter records
+ *          are relayed, time synchronization is the gateway's one and the
+ *          other messages (telemetry, history) stay on the device console.
+ * @author  ael-mess
+ *
+ * @addtogroup NET
+ * @{
+ */
+
+#include "stdio.h"
+#include "string.h"
+
+#include "esp_system.h"
+
+#include "app_transport.h"
+#include "app_espnow.h"
+#include "app_relay.h"
+#include "app_time.h"
+
+#include "app_log.h"
+#if CONFIG_ENABLE_LOGGING
+static const char* TAG = "app-leaf";
+#endif
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#if CONFIG_TRANSPORT_RELAY
+#define GATEWAY_MAC CONFIG_RELAY_GATEWAY_MAC
+#define RETRY_MS    CONFIG_RELAY_RETRY_MS
+#else
+#define GATEWAY_MAC ""
+#define RETRY_MS    1500
+#endif
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static app_relay_leaf_t m_leaf;
+static bool             m_started;
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static void leaf_poll(void) {
+    if (m_started) {
+        app_relay_leaf_poll(&m_leaf, app_time_now());
+    }
+}
+
+static esp_err_t leaf_send_records(const app_record_t* records, size_t count) {
+    if (!m_started) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (app_relay_leaf_push(&m_leaf, records, count) != 0) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    // first frame out at once
+    app_relay_leaf_poll(&m_leaf, app_time_now());
+    return ESP_OK;
+}
+
+static esp_err_t leaf_send(app_transport_class_t msg_class, const char* data) {
+    // not relayed, on the console only
+    RTN_LOGI(TAG, "%s", data);
+    return ESP_OK;
+}
+
+static size_t leaf_stats(char* buf, size_t len) { return app_relay_leaf_encode(&m_leaf, buf, len); }
+
+static esp_err_t leaf_start(uint8_t mac[6]) {
+    uint8_t gateway[6];
+    if (sscanf(GATEWAY_MAC, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &gateway[0], &gateway[1], &gateway[2], &gateway[3],
+               &gateway[4], &gateway[5]) != 6) {
+        RTN_LOGE(TAG, "Bad gateway MAC address %s", GATEWAY_MAC);
+        return ESP_ERR_INVALID_ARG;
+    }
+    RTN_LOGI(TAG, "Initializing relay to " MACSTR, MAC2STR(gateway));
+
+    app_relay_link_t link;
+    esp_err_t        err = app_espnow_init(&link);
+    if (err != ESP_OK) {
+        return err;
+    }
+    app_relay_leaf_init(&m_leaf, &link, gateway, RETRY_MS);
+    m_started = true;
+    return ESP_OK;
+}
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+const app_transport_t app_leaf_transport = {
+    .name         = "espnow",
+    .start        = leaf_start,
+    .send         = leaf_send,
+    .poll         = leaf_poll,
+    .stats        = leaf_stats,
+    .send_records = leaf_send_records,
+};
+
+/** @} */
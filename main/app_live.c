@@ -0,0 +1,106 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_live.c
+ * @brief   Live counter state and recent history.
+ * @note    Pure C, no ESP-IDF dependency. One writer (sampling task) and any
+ *          number of readers, synchronized by a sequence lock without blocking.
+ * @author  ael-mess
+ *
+ * @addtogroup MAIN
+ * @{
+ */
+
+#include "string.h"
+
+#include "app_live.h"
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static volatile uint32_t m_lock; /* odd while the writer updates the state */
+static app_record_t      m_current;
+static uint32_t          m_seq; /* incremented on each counter change */
+static app_record_t      m_history[APP_LIVE_HISTORY];
+static uint32_t          m_history_head;
+static uint32_t          m_history_len;
+static bool              m_valid;
+
+/**
+ * @brief   Update live counter.
+ * @note    The history keeps the last counter changes.
+ *
+ * @param[in] record    last counter record
+ * @return              retrun true if the counter changed
+ *
+ */
+bool app_live_push(const app_record_t* record) {
+    bool changed = !m_valid || (record->count != m_current.count);
+
+    m_lock++;
+    __sync_synchronize();
+    m_current = *record;
+    m_valid   = true;
+    if (changed) {
+        m_seq++;
+        m_history[(m_history_head + m_history_len) % APP_LIVE_HISTORY] = *record;
+        if (m_history_len < APP_LIVE_HISTORY) {
+            m_history_len++;
+        } else {
+            m_history_head = (m_history_head + 1) % APP_LIVE_HISTORY;
+        }
+    }
+    __sync_synchronize();
+    m_lock++;
+
+    return changed;
+}
+
+/**
+ * @brief   Live counter getter.
+ *
+ * @param[out] record   last counter record
+ * @param[out] seq      change sequence number
+ * @return              retrun false if no record was pushed yet
+ *
+ */
+bool app_live_current(app_record_t* record, uint32_t* seq) {
+    uint32_t lock;
+    bool     valid;
+    do {
+        lock = m_lock;
+        __sync_synchronize();
+        *record = m_current;
+        *seq    = m_seq;
+        valid   = m_valid;
+        __sync_synchronize();
+    } while ((lock & 1) || (lock != m_lock));
+
+    return valid;
+}
+
+/**
+ * @brief   Recent history getter.
+ *
+ * @param[out] records  counter changes, oldest first
+ * @param[in] max       records capacity
+ * @return              number of records
+ *
+ */
+size_t app_live_history(app_record_t* records, size_t max) {
+    uint32_t lock;
+    size_t   count;
+    do {
+        lock = m_lock;
+        __sync_synchronize();
+        count = (m_history_len < max) ? m_history_len : max;
+        for (size_t i = 0; i < count; i++) {
+            records[i] = m_history[(m_history_head + m_history_len - count + i) % APP_LIVE_HISTORY];
+        }
+        __sync_synchronize();
+    } while ((lock & 1) || (lock != m_lock));
+
+    return count;
+}
+
+/** @} */
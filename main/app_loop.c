@@ -0,0 +1,167 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_loop.c
+ * @brief   Task loop period, jitter and stall monitor.
+ * @note    Pure C, no ESP-IDF dependency. A task marks each wake and each
+ *          sleep of its loop: the wake to wake time is the actual period,
+ *          compared with the period the task asked for, and the wake to sleep
+ *          time is the work done in the loop. A loop overrunning its period
+ *          or busy for longer than the threshold is a stall.
+ * @author  ael-mess
+ *
+ * @addtogroup MAIN
+ * @{
+ */
+
+#include "stdio.h"
+#include "string.h"
+
+#include "app_loop.h"
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static const uint32_t m_bins_us[APP_LOOP_BINS - 1] = {100, 1000, 10000, 100000};
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static bool loop_stall(app_loop_t* l, uint32_t late_us, uint32_t busy_us) {
+    if (l->stalled) {
+        return false;
+    }
+    l->stalled      = true;
+    l->last_late_us = late_us;
+    l->last_busy_us = busy_us;
+    l->stalls_total++;
+    l->stats.stalls++;
+    return true;
+}
+
+/**
+ * @brief   Initialize loop monitor.
+ *
+ * @param[out] l            loop monitor pointer
+ * @param[in] name          task name
+ * @param[in] threshold_us  stall threshold
+ *
+ */
+void app_loop_init(app_loop_t* l, const char* name, uint32_t threshold_us) {
+    memset(l, 0, sizeof(app_loop_t));
+    l->name         = name;
+    l->threshold_us = threshold_us;
+    app_loop_reset(l);
+}
+
+/**
+ * @brief   Mark the start of a loop.
+ *
+ * @param[in,out] l         loop monitor pointer
+ * @param[in] now_us        wake time, monotonic clock
+ * @param[in] expected_us   period expected until the next wake, 0 if the loop is not periodic
+ * @return                  true if the last period overran by more than the threshold
+ *
+ */
+bool app_loop_wake(app_loop_t* l, int64_t now_us, uint32_t expected_us) {
+    bool stall = false;
+
+    if ((l->wake_us != 0) && (l->expected_us != 0)) {
+        uint32_t period = (uint32_t)(now_us - l->wake_us);
+        uint32_t late   = (period > l->expected_us) ? period - l->expected_us : 0;
+        uint32_t dev    = (period > l->expected_us) ? late : l->expected_us - period;
+
+        int bin = 0;
+        while ((bin < APP_LOOP_BINS - 1) && (dev >= m_bins_us[bin])) {
+            bin++;
+        }
+        l->stats.jitter[bin]++;
+        l->stats.periods++;
+        l->stats.period_sum_us += period;
+        l->stats.period_min_us = (period < l->stats.period_min_us) ? period : l->stats.period_min_us;
+        l->stats.period_max_us = (period > l->stats.period_max_us) ? period : l->stats.period_max_us;
+        l->stats.late_max_us   = (late > l->stats.late_max_us) ? late : l->stats.late_max_us;
+
+        // an overrun following a loop already reported busy is the same stall
+        if (late > l->threshold_us) {
+            stall = loop_stall(l, late, 0);
+        }
+    }
+
+    l->stalled     = stall;
+    l->wake_us     = now_us;
+    l->expected_us = expected_us;
+    l->stats.loops++;
+    return stall;
+}
+
+/**
+ * @brief   Mark the end of the work of a loop.
+ *
+ * @param[in,out] l     loop monitor pointer
+ * @param[in] now_us    sleep time, monotonic clock
+ * @return              true if the loop was busy for longer than the threshold
+ *
+ */
+bool app_loop_sleep(app_loop_t* l, int64_t now_us) {
+    if (l->wake_us == 0) {
+        return false;
+    }
+
+    uint32_t busy        = (uint32_t)(now_us - l->wake_us);
+    l->stats.busy_max_us = (busy > l->stats.busy_max_us) ? busy : l->stats.busy_max_us;
+    return (busy > l->threshold_us) && loop_stall(l, 0, busy);
+}
+
+/**
+ * @brief   Encode loop statistics record.
+ *
+ * @param[in] l     loop monitor pointer
+ * @param[out] buf  output buffer
+ * @param[in] len   output buffer size
+ * @return          encoded length, 0 if the buffer is too small
+ *
+ */
+size_t app_loop_encode(const app_loop_t* l, char* buf, size_t len) {
+    const app_loop_stats_t* s = &l->stats;
+    int n = snprintf(buf, len,
+                     "{ \"type\": \"loop\", \"task\": \"%s\", \"loops\": %u, \"period_us\": [%u, %u, %u], "
+                     "\"jitter\": [%u, %u, %u, %u, %u], \"late_max_us\": %u, \"busy_max_us\": %u, \"stalls\": %u }",
+                     l->name, (unsigned)s->loops, s->periods ? (unsigned)s->period_min_us : 0,
+                     s->periods ? (unsigned)(s->period_sum_us / s->periods) : 0, (unsigned)s->period_max_us,
+                     (unsigned)s->jitter[0], (unsigned)s->jitter[1], (unsigned)s->jitter[2], (unsigned)s->jitter[3],
+                     (unsigned)s->jitter[4], (unsigned)s->late_max_us, (unsigned)s->busy_max_us,
+                     (unsigned)s->stalls);
+    return ((n > 0) && ((size_t)n < len)) ? (size_t)n : 0;
+}
+
+/**
+ * @brief   Encode stall alarm record.
+ *
+ * @param[in] l     loop monitor pointer
+ * @param[out] buf  output buffer
+ * @param[in] len   output buffer size
+ * @return          encoded length, 0 if the buffer is too small
+ *
+ */
+size_t app_loop_encode_stall(const app_loop_t* l, char* buf, size_t len) {
+    int n = snprintf(buf, len,
+                     "{ \"type\": \"stall\", \"task\": \"%s\", \"late_us\": %u, \"busy_us\": %u, \"threshold_us\": %u, "
+                     "\"stalls\": %u }",
+                     l->name, (unsigned)l->last_late_us, (unsigned)l->last_busy_us, (unsigned)l->threshold_us,
+                     (unsigned)l->stalls_total);
+    return ((n > 0) && ((size_t)n < len)) ? (size_t)n : 0;
+}
+
+/**
+ * @brief   Start a new statistics window.
+ *
+ * @param[in,out] l     loop monitor pointer
+ *
+ */
+void app_loop_reset(app_loop_t* l) {
+    memset(&l->stats, 0, sizeof(app_loop_stats_t));
+    l->stats.period_min_us = UINT32_MAX;
+}
+
+/** @} */
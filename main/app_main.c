@@ -9,40 +9,380 @@
  * @{
  */
 
+#include "string.h"
+
 #include "esp_err.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 
 #include "app_nvs.h"
 #include "app_wifi.h"
-#include "app_mqtt.h"
+#include "app_transport.h"
 #include "app_sensor.h"
 #include "app_ota.h"
+#include "app_time.h"
+#include "app_analytics.h"
+#include "app_config.h"
+#include "app_sys.h"
+#include "app_retain.h"
+#include "app_seq.h"
+#include "app_policy.h"
+#include "app_live.h"
+#include "app_http.h"
+#include "app_loop.h"
+#include "app_slot.h"
+#include "app_history.h"
+#include "app_gateway.h"
+
+#if CONFIG_APP_BENCHMARK
+#include "bench.h"
+#endif
+
+#define WIFI_SSID          CONFIG_ESP_WIFI_SSID
+#define WIFI_PASS          CONFIG_ESP_WIFI_PASSWORD
+#define TELEMETRY_INTERVAL CONFIG_TELEMETRY_INTERVAL
+#define SAMPLE_STACK       CONFIG_APP_SAMPLE_STACK
+#define PUBLISH_STACK      CONFIG_APP_PUBLISH_STACK
+#define RECORD_QUEUE_LEN   CONFIG_APP_RECORD_QUEUE_LEN
+#define SUMMARY_QUEUE_LEN  2
+#define HTTP_STACK         CONFIG_HTTP_STACK
+#define STALL_THRESHOLD_US (CONFIG_APP_STALL_THRESHOLD * 1000)
+#define STALL_SPACING_US   10000000LL /* one alarm per task at most every 10 s */
+#define SLOT_SPREAD        CONFIG_PUBLISH_SLOT_SPREAD
+#define DRAIN_PERIOD       (CONFIG_PUBLISH_SLOT_SPREAD / CONFIG_PUBLISH_DRAIN_PER_SLOT)
+
+static app_record_t m_batch[CONFIG_PUBLISH_MAX_BATCH];
+static char         m_footprint[512];
+static uint32_t     m_first_seq;
+static uint32_t     m_slot_ms; /* device phase offset */
+static app_policy_t m_policy;
+static portMUX_TYPE m_policy_lock = portMUX_INITIALIZER_UNLOCKED;
+static app_loop_t   m_sample_loop;
+static portMUX_TYPE m_loop_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static StaticTask_t  m_sample_tcb;
+static StackType_t   m_sample_stack[SAMPLE_STACK];
+static StaticTask_t  m_publish_tcb;
+static StackType_t   m_publish_stack[PUBLISH_STACK];
+static StaticQueue_t m_record_queue;
+static uint8_t       m_record_storage[RECORD_QUEUE_LEN * sizeof(app_record_t)];
+static QueueHandle_t m_records;
+
+#if CONFIG_ENABLE_HTTP
+static StaticTask_t m_http_tcb;
+static StackType_t  m_http_stack[HTTP_STACK];
+#endif
+
+#if CONFIG_APP_BENCHMARK
+static StaticTask_t m_bench_tcb;
+static StackType_t  m_bench_stack[CONFIG_APP_BENCHMARK_STACK];
+#endif
+
+#if CONFIG_ENABLE_ANALYTICS
+static app_analytics_t m_analytics;
+static StaticQueue_t   m_summary_queue;
+static uint8_t         m_summary_storage[SUMMARY_QUEUE_LEN * sizeof(app_analytics_summary_t)];
+static QueueHandle_t   m_summaries;
+#endif
+
+static void slot_delay(uint32_t period_ms) {
+    int64_t now_us = app_time_now();
+    vTaskDelay((app_slot_next(now_us, period_ms, m_slot_ms) - now_us) / 1000 / portTICK_PERIOD_MS);
+}
+
+static void sample_task(void* arg) {
+    app_config_t start;
+    app_config_get(&start);
+
+    // sampling, hence publishing, runs in the device slot
+    slot_delay(start.publish_ms);
+    TickType_t wake = xTaskGetTickCount();
+
+    app_policy_init(&m_policy);
+#if CONFIG_ENABLE_ANALYTICS
+    app_analytics_init(&m_analytics, APP_ANALYTICS_INTERVAL);
+#endif
 
-#define WIFI_SSID CONFIG_ESP_WIFI_SSID
-#define WIFI_PASS CONFIG_ESP_WIFI_PASSWORD
+    while (true) {
+        app_config_t config;
+        app_config_get(&config);
+
+        portENTER_CRITICAL(&m_loop_lock);
+        app_loop_wake(&m_sample_loop, app_time_now(), config.publish_ms * 1000);
+        portEXIT_CRITICAL(&m_loop_lock);
+
+        app_record_t record = {
+            .count   = app_sensor_get_count(),
+            .mono_us = app_time_now(),
+        };
+        app_retain_store(record.count);
+#if CONFIG_ENABLE_HISTORY
+        app_history_sample(record.mono_us, record.count);
+#endif
+        if (app_live_push(&record)) {
+            app_http_notify();
+        }
+
+        app_policy_config_t policy = {
+            .deadband     = config.deadband,
+            .min_ms       = config.min_ms,
+            .heartbeat_ms = config.heartbeat_s * 1000,
+        };
+        // without a reserved sequence number the sample is not submitted to the policy, the change is published once
+        // the reservation is written
+        app_policy_decision_t decision = APP_POLICY_SUPPRESS;
+        if (app_seq_ready()) {
+            portENTER_CRITICAL(&m_policy_lock);
+            decision = app_policy_check(&m_policy, &policy, record.count, record.mono_us);
+            portEXIT_CRITICAL(&m_policy_lock);
+        }
+
+        // only published records are numbered, ingest sees no gap for suppressed samples
+        if (decision != APP_POLICY_SUPPRESS) {
+            record.seq = app_seq_next();
+            if (xQueueSend(m_records, &record, 0) != pdTRUE) {
+                // the publisher is not keeping up, the oldest record is dropped
+                app_record_t dropped;
+                xQueueReceive(m_records, &dropped, 0);
+                xQueueSend(m_records, &record, 0);
+            }
+        }
+
+#if CONFIG_ENABLE_ANALYTICS
+        app_analytics_summary_t summary;
+        if (app_analytics_sample(&m_analytics, record.count, record.mono_us, &summary)) {
+            xQueueSend(m_summaries, &summary, 0);
+        }
+#endif
+
+        portENTER_CRITICAL(&m_loop_lock);
+        app_loop_sleep(&m_sample_loop, app_time_now());
+        portEXIT_CRITICAL(&m_loop_lock);
+
+        // period accurate, after a stall longer than a period the schedule restarts in the device slot instead of
+        // sampling in a burst
+        TickType_t period = config.publish_ms / portTICK_PERIOD_MS;
+        if ((TickType_t)(xTaskGetTickCount() - wake) >= period) {
+            slot_delay(config.publish_ms);
+            wake = xTaskGetTickCount();
+        } else {
+            vTaskDelayUntil(&wake, period);
+        }
+    }
+}
+
+static void publish_stall(const app_loop_t* loop, uint32_t* seen, int64_t* alarm_us) {
+    int64_t now_us = app_time_now();
+    if ((loop->stalls_total == *seen) || ((now_us - *alarm_us) < STALL_SPACING_US)) {
+        return;
+    }
+
+    char data[160];
+    if (app_loop_encode_stall(loop, data, sizeof(data)) > 0) {
+        app_transport_publish_telemetry(data);
+    }
+    *seen     = loop->stalls_total;
+    *alarm_us = now_us;
+}
+
+static void publish_task(void* arg) {
+    size_t     batched      = 0;
+    int64_t    telemetry_us = app_time_now();
+    int64_t    retry_us     = 0;
+    app_loop_t loop;
+    uint32_t   stalls[2]   = {0};
+    int64_t    alarm_us[2] = {0};
+
+    app_loop_init(&loop, APP_SYS_PUBLISH_TASK, STALL_THRESHOLD_US);
+
+    // keep running across WiFi drops, the transport recovers and its in-flight window bounds the backlog
+    while (true) {
+        app_config_t config;
+        app_config_get(&config);
+
+        app_record_t record;
+        app_loop_sleep(&loop, app_time_now());
+        if ((batched < CONFIG_PUBLISH_MAX_BATCH) &&
+            (xQueueReceive(m_records, &record, config.publish_ms / portTICK_PERIOD_MS) == pdTRUE)) {
+            m_batch[batched++] = record;
+        }
+        // a record or the receive timeout wakes it once per publish interval
+        app_loop_wake(&loop, app_time_now(), config.publish_ms * 1000);
+
+        app_transport_poll();
+#if CONFIG_ENABLE_HISTORY
+        app_history_poll();
+#endif
+#if CONFIG_RELAY_GATEWAY
+        app_gateway_poll();
+#endif
+
+        int64_t boot_utc_ms;
+        if (app_time_take_sync(&boot_utc_ms) && (app_transport_publish_sync(boot_utc_ms, m_first_seq) != ESP_OK)) {
+            // the backend needs it to correct the unsynchronized records, sent again on the next loop
+            app_time_mark_sync();
+        }
+
+        // a batch size reduced at runtime flushes the pending records at once, a failed publish is retried in the
+        // device slot so that devices back from an outage drain their backlog apart, PUBLISH_DRAIN_PER_SLOT
+        // messages per slot period
+        bool ready = (batched >= config.batch_size) && (app_time_now() >= retry_us);
+        if (ready && (app_transport_publish(m_batch, batched) == ESP_OK)) {
+            batched = 0;
+            if (uxQueueMessagesWaiting(m_records) > 0) {
+                retry_us = app_slot_next(app_time_now() + 1, DRAIN_PERIOD, m_slot_ms);
+            }
+        } else {
+            if (ready) {
+                retry_us = app_slot_next(app_time_now() + 1, SLOT_SPREAD, m_slot_ms);
+            }
+            if (batched == CONFIG_PUBLISH_MAX_BATCH) {
+                // the broker is not keeping up, leave the next records in the queue
+                vTaskDelay(config.publish_ms / portTICK_PERIOD_MS);
+            }
+        }
+
+#if CONFIG_ENABLE_ANALYTICS
+        app_analytics_summary_t summary;
+        if (xQueuePeek(m_summaries, &summary, 0) == pdTRUE) {
+            if (app_transport_publish_summary(&summary) != ESP_ERR_TIMEOUT) {
+                xQueueReceive(m_summaries, &summary, 0);
+            }
+        }
+#endif
+
+        app_loop_t sample;
+        portENTER_CRITICAL(&m_loop_lock);
+        sample = m_sample_loop;
+        portEXIT_CRITICAL(&m_loop_lock);
+        publish_stall(&sample, &stalls[0], &alarm_us[0]);
+        publish_stall(&loop, &stalls[1], &alarm_us[1]);
+
+        int64_t now_us = app_time_now();
+        if ((now_us - telemetry_us) >= TELEMETRY_INTERVAL * 1000000LL) {
+            telemetry_us = now_us;
+            app_transport_publish_stats();
+            if (app_sys_footprint(m_footprint, sizeof(m_footprint)) > 0) {
+                app_transport_publish_telemetry(m_footprint);
+            }
+
+            char               data[320];
+            app_policy_stats_t policy;
+            portENTER_CRITICAL(&m_policy_lock);
+            policy = m_policy.stats;
+            portEXIT_CRITICAL(&m_policy_lock);
+            if (app_policy_encode(&policy, data, sizeof(data)) > 0) {
+                app_transport_publish_telemetry(data);
+            }
+            if (app_sensor_stats(data, sizeof(data)) > 0) {
+                app_transport_publish_telemetry(data);
+            }
+#if CONFIG_ENABLE_HISTORY
+            if (app_history_stats(data, sizeof(data)) > 0) {
+                app_transport_publish_telemetry(data);
+            }
+#endif
+#if CONFIG_RELAY_GATEWAY
+            if (app_gateway_stats(data, sizeof(data)) > 0) {
+                app_transport_publish_telemetry(data);
+            }
+#endif
+
+            // loop statistics over the telemetry interval
+            portENTER_CRITICAL(&m_loop_lock);
+            sample = m_sample_loop;
+            app_loop_reset(&m_sample_loop);
+            portEXIT_CRITICAL(&m_loop_lock);
+            if (app_loop_encode(&sample, data, sizeof(data)) > 0) {
+                app_transport_publish_telemetry(data);
+            }
+            if (app_loop_encode(&loop, data, sizeof(data)) > 0) {
+                app_transport_publish_telemetry(data);
+            }
+            app_loop_reset(&loop);
+        }
+    }
+}
+
+#if CONFIG_ENABLE_HTTP
+static void http_task(void* arg) {
+    while (true) {
+        app_http_poll(1000);
+    }
+}
+#endif
+
+#if CONFIG_APP_BENCHMARK
+static void bench_task(void* arg) {
+    bench_run_all(CONFIG_APP_BENCHMARK_FILTER);
+    vTaskDelete(NULL);
+}
+#endif
 
 void app_main(void) {
     app_ota_check_boot();
 
-    // TODO: store WiFi config and counter later
+    // TODO: store WiFi config later
     app_nvs_init(NULL, NULL, NULL, NULL);
 
+#if CONFIG_APP_BENCHMARK
+    // benchmark firmware, the counter does not start, the application core runs nothing else
+    xTaskCreateStaticPinnedToCore(bench_task, "bench", CONFIG_APP_BENCHMARK_STACK, NULL, 1, m_bench_stack,
+                                  &m_bench_tcb, portNUM_PROCESSORS - 1);
+    return;
+#endif
+    app_config_init();
+    app_sensor_set_count(app_retain_restore());
+    ESP_ERROR_CHECK(app_sensor_init());
+    m_first_seq = app_seq_init();
+#if CONFIG_ENABLE_HISTORY
+    // the device keeps counting without history
+    app_history_init();
+#endif
+    app_loop_init(&m_sample_loop, APP_SYS_SAMPLE_TASK, STALL_THRESHOLD_US);
+
+#if CONFIG_TRANSPORT_RELAY
+    // leaf, the radio only, records go to the gateway
+    ESP_ERROR_CHECK(app_wifi_open_radio(CONFIG_RELAY_CHANNEL));
+#else
     // TODO: use non blocking loop
     ESP_ERROR_CHECK(app_wifi_open(WIFI_SSID, WIFI_PASS, "", ""));
     while (!app_wifi_isconnected()) {
         vTaskDelay(1000 / portTICK_PERIOD_MS);
     }
+#endif
 
     uint8_t mac[6] = {0};
     app_wifi_getmac(mac);
-    ESP_ERROR_CHECK(app_mqtt_start(mac));
 
-    while (app_wifi_isconnected()) {
-        app_mqtt_publish(app_sensor_get_count());
-        vTaskDelay(1000 / portTICK_PERIOD_MS);
+    // devices powered together connect apart
+    m_slot_ms = app_slot_offset(mac, SLOT_SPREAD);
+    vTaskDelay(m_slot_ms / portTICK_PERIOD_MS);
+    ESP_ERROR_CHECK(app_transport_start(mac));
+#if CONFIG_RELAY_GATEWAY
+    // the device keeps counting without leaves
+    app_gateway_init();
+#endif
+
+    m_records = xQueueCreateStatic(RECORD_QUEUE_LEN, sizeof(app_record_t), m_record_storage, &m_record_queue);
+#if CONFIG_ENABLE_ANALYTICS
+    m_summaries = xQueueCreateStatic(SUMMARY_QUEUE_LEN, sizeof(app_analytics_summary_t), m_summary_storage,
+                                     &m_summary_queue);
+#endif
+
+    xTaskCreateStatic(sample_task, APP_SYS_SAMPLE_TASK, SAMPLE_STACK, NULL, CONFIG_APP_SAMPLE_PRIORITY,
+                      m_sample_stack, &m_sample_tcb);
+    xTaskCreateStatic(publish_task, APP_SYS_PUBLISH_TASK, PUBLISH_STACK, NULL, CONFIG_APP_PUBLISH_PRIORITY,
+                      m_publish_stack, &m_publish_tcb);
+
+#if CONFIG_ENABLE_HTTP
+    if (app_http_init(CONFIG_HTTP_PORT, app_time_now, app_time_to_utc) == 0) {
+        xTaskCreateStatic(http_task, APP_SYS_HTTP_TASK, HTTP_STACK, NULL, CONFIG_HTTP_PRIORITY, m_http_stack,
+                          &m_http_tcb);
     }
+#endif
 }
 
 /** @} */
@@ -3,18 +3,37 @@
  *
  * @file    app_mqtt.c
  * @brief   MQTT driver.
+ * @note    The session runs on the highest priority broker of the list that
+ *          is reachable. A lost session moves to the next broker, at once to a
+ *          standby session kept connected to it (CONFIG_MQTT_STANDBY), after
+ *          CONFIG_MQTT_FAILOVER_MS otherwise. Messages awaiting acknowledge are
+ *          kept until acknowledged and published again on the new session.
  * @author  ael-mess
  *
  * @addtogroup NET
  * @{
  */
 
+#include "stdlib.h"
 #include "string.h"
 
 #include "esp_system.h"
 #include "esp_event.h"
+#include "esp_timer.h"
+#include "esp_idf_version.h"
 #include "mqtt_client.h"
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "app_mqtt.h"
+#include "app_transport.h"
+
+#include "app_broker.h"
+#include "app_config.h"
+#include "app_history.h"
+#include "app_slot.h"
+
 #include "app_log.h"
 #if CONFIG_ENABLE_LOGGING
 static const char* TAG = "app-mqtt";
@@ -26,24 +45,320 @@ static const char* TAG = "app-mqtt";
 #define BROKER_HOST  CONFIG_BROKER_HOST
 #define BROKER_PORT  CONFIG_BROKER_PORT
 #define BROKER_TOPIC CONFIG_BROKER_TOPIC
+#define CMD_TOPIC    CONFIG_BROKER_CMD_TOPIC
+#define ACK_TOPIC    CONFIG_BROKER_ACK_TOPIC
+#if CONFIG_ENABLE_HISTORY
+#define HISTORY_TOPIC CONFIG_BROKER_HISTORY_TOPIC
+#endif
 #define DEVICE_ID    CONFIG_DEVICE_ID
 #define DEVICE_KEY   CONFIG_DEVICE_KEY
 
+#define QOS_COUNT       CONFIG_MQTT_QOS_COUNT
+#define QOS_TELEMETRY   CONFIG_MQTT_QOS_TELEMETRY
+#define INFLIGHT_WINDOW CONFIG_MQTT_INFLIGHT_WINDOW
+#define INFLIGHT_WAIT   CONFIG_MQTT_INFLIGHT_WAIT
+#define INFLIGHT_EXPIRE CONFIG_MQTT_INFLIGHT_EXPIRE
+#define SLOT_FREE       0
+#define SLOT_RESERVED   (-1)
+#define RECONNECT_MS    10000 /* esp-mqtt default, the device slot is added */
+
+#if CONFIG_MQTT_FAILOVER
+#define FALLBACK_BROKERS CONFIG_MQTT_FALLBACK_BROKERS
+#define FAILOVER_MS      CONFIG_MQTT_FAILOVER_MS
+#define COPY_SIZE        CONFIG_MQTT_OUT_BUFFER_SIZE
+#else
+#define FALLBACK_BROKERS NULL
+#endif
+
+#if CONFIG_MQTT_STANDBY
+#define SESSIONS 2 /* active and standby */
+#else
+#define SESSIONS 1
+#endif
+
 /*===========================================================================*/
 /* Local variables.                                                          */
 /*===========================================================================*/
-static esp_mqtt_client_handle_t m_client;
+typedef struct {
+    int                    msg_id; /* SLOT_FREE, SLOT_RESERVED or awaiting acknowledge */
+    int64_t                sent_us;
+    app_transport_report_t report; /* delivery report, the slot is the token, NULL if not tracked */
+#if CONFIG_MQTT_FAILOVER
+    bool   handoff; /* to publish again on the new session */
+    size_t len;     /* 0 if the message was not copied */
+#endif
+} inflight_t;
+
+typedef struct {
+    esp_mqtt_client_handle_t handle;
+    int                      broker; /* broker index, -1 if unused */
+    bool                     connected;
+    bool                     was_connected;
+    int64_t                  connect_us; /* connection attempt start */
+    int64_t                  down_us;    /* session start or connection loss */
+} session_t;
+
+static char              m_topic[128];
+static char              m_cmd_topic[128];
+#if CONFIG_ENABLE_HISTORY
+static char m_history_topic[128];
+#endif
+static char              m_client_id[64];
+static char              m_username[16];
+static uint32_t          m_reconnect_ms;
+static app_broker_list_t m_brokers;
+static session_t         m_sessions[SESSIONS];
+static int               m_active; /* session in use */
+
+static SemaphoreHandle_t m_window;
+static StaticSemaphore_t m_window_buffer;
+static portMUX_TYPE      m_lock = portMUX_INITIALIZER_UNLOCKED;
+static inflight_t        m_inflight[INFLIGHT_WINDOW];
+static int               m_early_acks[INFLIGHT_WINDOW]; /* acknowledges received before the slot was filled */
+static int               m_early_head;
+static app_mqtt_stats_t  m_stats;
+#if CONFIG_MQTT_FAILOVER
+static char* m_copies; /* COPY_SIZE bytes per in-flight slot, NULL without fallback broker */
+#endif
+
+#if CONFIG_BROKER_USE_TLS
+extern const char ca_bundle_pem_start[] asm("_binary_ca_bundle_pem_start");
+#endif
 
 /*===========================================================================*/
 /* Local functions.                                                          */
 /*===========================================================================*/
-static void mqtt_event_handler_cb(esp_mqtt_event_handle_t event) {
+static uint32_t inflight_count(void) {
+    uint32_t count = 0;
+    for (int i = 0; i < INFLIGHT_WINDOW; i++) {
+        count += (m_inflight[i].msg_id != SLOT_FREE);
+    }
+    return count;
+}
+
+static void inflight_expire(void) {
+    int64_t now     = esp_timer_get_time();
+    int     expired = 0;
+
+    app_transport_report_t reports[INFLIGHT_WINDOW] = {NULL};
+
+    // esp-mqtt drops outbox messages that stay unacknowledged too long, their slots are reclaimed
+    portENTER_CRITICAL(&m_lock);
+    for (int i = 0; i < INFLIGHT_WINDOW; i++) {
+        if ((m_inflight[i].msg_id > 0) && ((now - m_inflight[i].sent_us) > INFLIGHT_EXPIRE * 1000LL)) {
+            m_inflight[i].msg_id = SLOT_FREE;
+            reports[i]           = m_inflight[i].report;
+            expired++;
+        }
+    }
+    m_stats.expired += expired;
+    portEXIT_CRITICAL(&m_lock);
+
+    while (expired--) {
+        xSemaphoreGive(m_window);
+    }
+    for (int i = 0; i < INFLIGHT_WINDOW; i++) {
+        if (reports[i] != NULL) {
+            reports[i](i, false);
+        }
+    }
+}
+
+static int inflight_reserve(void) {
+    int slot = -1;
+
+    portENTER_CRITICAL(&m_lock);
+    for (int i = 0; i < INFLIGHT_WINDOW; i++) {
+        if (m_inflight[i].msg_id == SLOT_FREE) {
+            m_inflight[i].msg_id = SLOT_RESERVED;
+            slot                 = i;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&m_lock);
+
+    return slot;
+}
+
+static void inflight_fill(int slot, int msg_id) {
+    bool                   acked  = (msg_id < 0);
+    app_transport_report_t report = NULL;
+
+    portENTER_CRITICAL(&m_lock);
+    for (int i = 0; (i < INFLIGHT_WINDOW) && !acked; i++) {
+        if (m_early_acks[i] == msg_id) {
+            m_early_acks[i] = SLOT_FREE;
+            acked           = true;
+        }
+    }
+    m_inflight[slot].msg_id  = acked ? SLOT_FREE : msg_id;
+    m_inflight[slot].sent_us = esp_timer_get_time();
+    report                   = (acked && (msg_id >= 0)) ? m_inflight[slot].report : NULL;
+    portEXIT_CRITICAL(&m_lock);
+
+    if (acked) {
+        xSemaphoreGive(m_window);
+    }
+    // acknowledged before the slot was filled
+    if (report != NULL) {
+        report(slot, true);
+    }
+}
+
+static void inflight_release(int msg_id) {
+    bool                   found  = false;
+    int                    slot   = 0;
+    app_transport_report_t report = NULL;
+
+    portENTER_CRITICAL(&m_lock);
+    for (int i = 0; i < INFLIGHT_WINDOW; i++) {
+        if (m_inflight[i].msg_id == msg_id) {
+            m_inflight[i].msg_id = SLOT_FREE;
+            found                = true;
+            slot                 = i;
+            report               = m_inflight[i].report;
+            break;
+        }
+    }
+    if (!found) {
+        m_early_acks[m_early_head] = msg_id;
+        m_early_head               = (m_early_head + 1) % INFLIGHT_WINDOW;
+    }
+    m_stats.acked++;
+    portEXIT_CRITICAL(&m_lock);
+
+    if (found) {
+        xSemaphoreGive(m_window);
+    }
+    if (report != NULL) {
+        report(slot, true);
+    }
+}
+
+static esp_err_t mqtt_publish(app_transport_class_t msg_class, const char* data, app_transport_report_t report,
+                              int* token) {
+    int qos  = (msg_class == APP_TRANSPORT_TELEMETRY) ? QOS_TELEMETRY : QOS_COUNT;
+    int slot = -1;
+
+    // backpressure: acknowledged messages are bounded by the in-flight window
+    if (qos > 0) {
+        inflight_expire();
+        if (xSemaphoreTake(m_window, INFLIGHT_WAIT / portTICK_PERIOD_MS) != pdTRUE) {
+            m_stats.throttled++;
+            RTN_LOGW(TAG, "In-flight window full, publish delayed");
+            return ESP_ERR_TIMEOUT;
+        }
+        slot                    = inflight_reserve();
+        m_inflight[slot].report = report;
+#if CONFIG_MQTT_FAILOVER
+        // the slot is owned until filled, the copy is published again if the session is lost
+        size_t len                = strlen(data);
+        m_inflight[slot].handoff = false;
+        m_inflight[slot].len     = ((m_copies != NULL) && (len < COPY_SIZE)) ? len : 0;
+        if (m_inflight[slot].len > 0) {
+            memcpy(m_copies + slot * COPY_SIZE, data, len);
+        }
+#endif
+    }
+
+    int msg_id = esp_mqtt_client_publish(m_sessions[m_active].handle, m_topic, data, 0, qos, 0);
+    if (slot >= 0) {
+        // a refused message is not reported, the caller knows
+        if (msg_id < 0) {
+            m_inflight[slot].report = NULL;
+        }
+        inflight_fill(slot, msg_id);
+    }
+    if (msg_id < 0) {
+        RTN_LOGE(TAG, "Publish failed");
+        return ESP_FAIL;
+    }
+
+    if ((token != NULL) && (report != NULL)) {
+        *token = slot;
+    }
+    m_stats.published++;
+    RTN_LOGI(TAG, "sent publish successful, msg_id=%d", msg_id);
+    return ESP_OK;
+}
+
+static esp_err_t mqtt_send(app_transport_class_t msg_class, const char* data) {
+    return mqtt_publish(msg_class, data, NULL, NULL);
+}
+
+static esp_err_t mqtt_send_tracked(const char* data, app_transport_report_t report, int* token) {
+    return mqtt_publish(APP_TRANSPORT_COUNT, data, report, token);
+}
+
+static void mqtt_command(esp_mqtt_event_handle_t event) {
+    const char* reason = "fragmented";
+    esp_err_t   ret    = ESP_FAIL;
+    if ((event->current_data_offset == 0) && (event->data_len == event->total_data_len)) {
+        ret = app_config_apply_json(event->data, event->data_len, &reason);
+    }
+
+    app_config_t config;
+    app_config_get(&config);
+
+    char data[128] = {'\0'};
+    if (ret == ESP_OK) {
+        sprintf(data, "{ \"type\": \"ack\", \"version\": %u, \"status\": \"ok\" }", config.version);
+    } else {
+        RTN_LOGW(TAG, "Configuration rejected: %s", reason);
+        sprintf(data, "{ \"type\": \"ack\", \"version\": %u, \"status\": \"error\", \"reason\": \"%s\" }",
+                config.version, reason);
+    }
+
+    // sent outside the in-flight window, a lost acknowledge is recovered by resending the command
+    char topic[128] = {'\0'};
+    sprintf(topic, ACK_TOPIC, DEVICE_ID);
+    esp_mqtt_client_publish(event->client, topic, data, 0, 0, 0);
+}
+
+static void mqtt_event_handler_cb(session_t* session, esp_mqtt_event_handle_t event) {
+    bool active = (session == &m_sessions[m_active]);
+
     switch (event->event_id) {
-    case MQTT_EVENT_CONNECTED:
-        RTN_LOGI(TAG, "MQTT_EVENT_CONNECTED");
+    case MQTT_EVENT_BEFORE_CONNECT:
+        session->connect_us = esp_timer_get_time();
         break;
+    case MQTT_EVENT_CONNECTED: {
+        // TCP, TLS handshake and MQTT CONNECT round trip
+        uint32_t connect_ms = (uint32_t)((esp_timer_get_time() - session->connect_us) / 1000);
+        RTN_LOGI(TAG, "MQTT_EVENT_CONNECTED, session_present=%d, connect=%u ms", event->session_present, connect_ms);
+        portENTER_CRITICAL(&m_lock);
+        m_stats.connect_ms     = connect_ms;
+        m_stats.connect_max_ms = (connect_ms > m_stats.connect_max_ms) ? connect_ms : m_stats.connect_max_ms;
+        if (active && session->was_connected) {
+            // unacknowledged messages are sent again from the outbox
+            m_stats.reconnects++;
+            m_stats.retransmits += inflight_count();
+        }
+        if (session->broker >= 0) {
+            app_broker_up(&m_brokers, session->broker);
+        }
+        session->connected     = true;
+        session->was_connected = true;
+        portEXIT_CRITICAL(&m_lock);
+        // commands are accepted from every broker, the standby session included
+        esp_mqtt_client_subscribe(event->client, m_cmd_topic, 1);
+#if CONFIG_ENABLE_HISTORY
+        esp_mqtt_client_subscribe(event->client, m_history_topic, 1);
+#endif
+        break;
+    }
     case MQTT_EVENT_DISCONNECTED:
+        // also raised when the connection attempt fails
         RTN_LOGI(TAG, "MQTT_EVENT_DISCONNECTED");
+        portENTER_CRITICAL(&m_lock);
+        if (session->broker >= 0) {
+            app_broker_down(&m_brokers, session->broker, esp_timer_get_time());
+        }
+        if (session->connected) {
+            session->down_us = esp_timer_get_time();
+        }
+        session->connected = false;
+        portEXIT_CRITICAL(&m_lock);
         break;
     case MQTT_EVENT_SUBSCRIBED:
         RTN_LOGI(TAG, "MQTT_EVENT_SUBSCRIBED, msg_id=%d", event->msg_id);
@@ -53,11 +368,25 @@ static void mqtt_event_handler_cb(esp_mqtt_event_handle_t event) {
         break;
     case MQTT_EVENT_PUBLISHED:
         RTN_LOGI(TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
+        // message ids are per session, a session given up no longer acknowledges
+        if (active) {
+            inflight_release(event->msg_id);
+        }
         break;
     case MQTT_EVENT_DATA:
         RTN_LOGI(TAG, "MQTT_EVENT_DATA");
         printf("TOPIC=%.*s\r\n", event->topic_len, event->topic);
         printf("DATA=%.*s\r\n", event->data_len, event->data);
+        if ((event->topic_len == strlen(m_cmd_topic)) && !strncmp(event->topic, m_cmd_topic, event->topic_len)) {
+            mqtt_command(event);
+        }
+#if CONFIG_ENABLE_HISTORY
+        if ((event->topic_len == strlen(m_history_topic)) &&
+            !strncmp(event->topic, m_history_topic, event->topic_len) &&
+            (app_history_request(event->data, event->data_len) != ESP_OK)) {
+            RTN_LOGW(TAG, "History request rejected");
+        }
+#endif
         break;
     case MQTT_EVENT_ERROR:
         RTN_LOGI(TAG, "MQTT_EVENT_ERROR");
@@ -69,50 +398,290 @@ static void mqtt_event_handler_cb(esp_mqtt_event_handle_t event) {
 }
 
 static void mqtt_event_handler(void* handler_args, esp_event_base_t base, int32_t event_id, void* event_data) {
-    mqtt_event_handler_cb(event_data);
+    mqtt_event_handler_cb(handler_args, event_data);
 }
 
-/**
- * @brief   Publish person counter.
- *
- * @param[in] count person counter
- * @return          retrun msg
- *
- */
-void app_mqtt_publish(uint8_t count) {
-    char data[128] = {'\0'};
-    sprintf(data, "{ \"type\": \"count\", \"value\": %d }", count);
+static esp_err_t session_open(session_t* session, int broker) {
+    const app_broker_t* b = &m_brokers.brokers[broker];
 
-    char topic[128] = {'\0'};
-    sprintf(topic, BROKER_TOPIC, DEVICE_ID);
+    // the broker resumes a persistent session by client id, it must be stable across reboots, and differ per broker
+    // in case brokers share sessions
+    char client_id[72] = {'\0'};
+    if (broker == 0) {
+        sprintf(client_id, "%s", m_client_id);
+    } else {
+        sprintf(client_id, "%s-%d", m_client_id, broker);
+    }
 
-    int msg_id = esp_mqtt_client_publish(m_client, topic, data, 0, 1, 0);
-    RTN_LOGI(TAG, "sent publish successful, msg_id=%d", msg_id);
+    esp_mqtt_client_config_t mqtt_cfg = {
+        .host                  = b->host,
+        .port                  = b->port,
+        .client_id             = client_id,
+        .username              = m_username,
+        .password              = DEVICE_KEY,
+        .disable_clean_session = CONFIG_MQTT_PERSISTENT_SESSION,
+        .buffer_size           = CONFIG_MQTT_BUFFER_SIZE,
+        .out_buffer_size       = CONFIG_MQTT_OUT_BUFFER_SIZE,
+        .task_stack            = CONFIG_MQTT_TASK_STACK,
+        .reconnect_timeout_ms  = m_reconnect_ms,
+#if CONFIG_BROKER_USE_TLS
+        .transport = MQTT_TRANSPORT_OVER_SSL,
+        .cert_pem  = ca_bundle_pem_start,
+#endif
+    };
+
+    esp_mqtt_client_handle_t handle = esp_mqtt_client_init(&mqtt_cfg);
+    if (handle == NULL) {
+        RTN_LOGE(TAG, "MQTT client allocation failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    portENTER_CRITICAL(&m_lock);
+    session->handle        = handle;
+    session->broker        = broker;
+    session->connected     = false;
+    session->was_connected = false;
+    session->down_us       = esp_timer_get_time();
+    portEXIT_CRITICAL(&m_lock);
+
+    RTN_LOGI(TAG, "Connecting to %s:%u", b->host, b->port);
+    esp_mqtt_client_register_event(handle, ESP_EVENT_ANY_ID, mqtt_event_handler, session);
+    return esp_mqtt_client_start(handle);
+}
+
+#if CONFIG_MQTT_FAILOVER
+static void session_close(session_t* session) {
+    // the events raised while stopping do not count against the broker
+    portENTER_CRITICAL(&m_lock);
+    session->broker    = -1;
+    session->connected = false;
+    portEXIT_CRITICAL(&m_lock);
+
+    // the client task is stopped and its outbox dropped, what it held is handed off from the in-flight copies
+    if (session->handle != NULL) {
+        esp_mqtt_client_destroy(session->handle);
+        session->handle = NULL;
+    }
+}
+
+static void mqtt_switch(int index) {
+    portENTER_CRITICAL(&m_lock);
+    m_active = index;
+    for (int i = 0; i < INFLIGHT_WINDOW; i++) {
+        m_early_acks[i] = SLOT_FREE;
+        if (m_inflight[i].msg_id > 0) {
+            m_inflight[i].msg_id  = SLOT_RESERVED;
+            m_inflight[i].handoff = true;
+        }
+    }
+    m_stats.failovers++;
+    portEXIT_CRITICAL(&m_lock);
+}
+
+static void mqtt_handoff(void) {
+    esp_mqtt_client_handle_t handle = m_sessions[m_active].handle;
+
+    // handed off slots are reserved, only this task writes them
+    for (int i = 0; i < INFLIGHT_WINDOW; i++) {
+        if (!m_inflight[i].handoff) {
+            continue;
+        }
+        if (m_inflight[i].len == 0) {
+            RTN_LOGW(TAG, "In-flight message not copied, not handed off");
+            app_transport_report_t report = m_inflight[i].report;
+            m_inflight[i].handoff         = false;
+            inflight_fill(i, -1);
+            portENTER_CRITICAL(&m_lock);
+            m_stats.expired++;
+            portEXIT_CRITICAL(&m_lock);
+            if (report != NULL) {
+                report(i, false);
+            }
+            continue;
+        }
+
+        int msg_id =
+            esp_mqtt_client_publish(handle, m_topic, m_copies + i * COPY_SIZE, m_inflight[i].len, QOS_COUNT, 0);
+        if (msg_id < 0) {
+            // retried on the next poll
+            break;
+        }
+        m_inflight[i].handoff = false;
+        inflight_fill(i, msg_id);
+        portENTER_CRITICAL(&m_lock);
+        m_stats.handoffs++;
+        portEXIT_CRITICAL(&m_lock);
+    }
+}
+
+static void mqtt_health(void) {
+    static app_broker_list_t brokers;
+    static char              data[512];
+
+    portENTER_CRITICAL(&m_lock);
+    brokers     = m_brokers;
+    int active  = m_sessions[m_active].broker;
+    int standby = (SESSIONS > 1) ? m_sessions[SESSIONS - 1 - m_active].broker : -1;
+    portEXIT_CRITICAL(&m_lock);
+
+    if (app_broker_encode(&brokers, active, standby, data, sizeof(data)) > 0) {
+        esp_mqtt_client_publish(m_sessions[m_active].handle, m_topic, data, 0, QOS_TELEMETRY, 0);
+    }
+}
+
+static void mqtt_failover(void) {
+    int64_t    now     = esp_timer_get_time();
+    session_t* active  = &m_sessions[m_active];
+    bool       changed = false;
+
+    portENTER_CRITICAL(&m_lock);
+    bool lost = !active->connected && ((now - active->down_us) >= FAILOVER_MS * 1000LL);
+    int  next = app_broker_pick(&m_brokers, now, active->broker);
+#if CONFIG_MQTT_STANDBY
+    session_t* standby = &m_sessions[1 - m_active];
+    // back to a higher priority broker only once nothing is in flight, so that nothing is delivered twice
+    bool promote = standby->connected &&
+                   (!active->connected || ((standby->broker < active->broker) && (inflight_count() == 0)));
+#else
+    bool promote = false;
+#endif
+    portEXIT_CRITICAL(&m_lock);
+
+#if CONFIG_MQTT_STANDBY
+    if (promote) {
+        // the standby session is already connected, only the in-flight messages are sent again
+        RTN_LOGW(TAG, "Switching to standby broker %d", standby->broker);
+        mqtt_switch(1 - m_active);
+        session_close(active);
+        changed = true;
+    } else if (lost && (next >= 0) && (standby->broker == next)) {
+        // the standby session is not connected yet, the active one takes its place
+        session_close(standby);
+    }
+#endif
+
+    if (!promote && lost && (next >= 0)) {
+        RTN_LOGW(TAG, "Broker %d lost, failing over to broker %d", active->broker, next);
+        mqtt_switch(m_active);
+        session_close(active);
+        session_open(active, next);
+        changed = true;
+    }
+
+#if CONFIG_MQTT_STANDBY
+    // the standby session follows the highest priority broker out of back-off, other than the active one
+    standby = &m_sessions[1 - m_active];
+    portENTER_CRITICAL(&m_lock);
+    int  target = app_broker_pick(&m_brokers, now, m_sessions[m_active].broker);
+    bool stuck  = !standby->connected && ((now - standby->down_us) >= FAILOVER_MS * 1000LL);
+    bool retarget =
+        (target >= 0) && (target != standby->broker) && ((standby->broker < 0) || (target < standby->broker) || stuck);
+    portEXIT_CRITICAL(&m_lock);
+
+    if (retarget) {
+        session_close(standby);
+        session_open(standby, target);
+    }
+#endif
+
+    if (changed) {
+        mqtt_health();
+    }
+}
+#endif
+
+static void mqtt_poll(void) {
+    inflight_expire();
+#if CONFIG_MQTT_FAILOVER
+    mqtt_failover();
+    mqtt_handoff();
+#endif
 }
 
 /**
- * @brief   Initialize MQTT.
+ * @brief   MQTT statistics getter.
  *
- * @return  retrun msg
+ * @param[out] stats    statistics snapshot
  *
  */
-esp_err_t app_mqtt_start(uint8_t mac[6]) {
+void app_mqtt_get_stats(app_mqtt_stats_t* stats) {
+    portENTER_CRITICAL(&m_lock);
+    *stats          = m_stats;
+    stats->inflight = inflight_count();
+    stats->broker   = m_sessions[m_active].broker;
+    stats->standby  = (SESSIONS > 1) ? m_sessions[SESSIONS - 1 - m_active].broker : -1;
+    portEXIT_CRITICAL(&m_lock);
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 4, 0)
+    esp_mqtt_client_handle_t handle = m_sessions[m_active].handle;
+    stats->outbox                   = (handle != NULL) ? esp_mqtt_client_get_outbox_size(handle) : -1;
+#else
+    stats->outbox = -1;
+#endif
+}
+
+static size_t mqtt_stats(char* buf, size_t len) {
+    app_mqtt_stats_t stats;
+    app_mqtt_get_stats(&stats);
+
+    int n = snprintf(buf, len,
+                     "{ \"type\": \"mqtt\", \"inflight\": %u, \"outbox\": %d, \"published\": %u, \"acked\": %u, "
+                     "\"expired\": %u, \"retransmits\": %u, \"reconnects\": %u, \"throttled\": %u, "
+                     "\"connect_ms\": %u, \"connect_max_ms\": %u, \"broker\": %d, \"standby\": %d, "
+                     "\"failovers\": %u, \"handoffs\": %u }",
+                     stats.inflight, stats.outbox, stats.published, stats.acked, stats.expired, stats.retransmits,
+                     stats.reconnects, stats.throttled, stats.connect_ms, stats.connect_max_ms, stats.broker,
+                     stats.standby, stats.failovers, stats.handoffs);
+    return ((n > 0) && ((size_t)n < len)) ? (size_t)n : 0;
+}
+
+static esp_err_t mqtt_start(uint8_t mac[6]) {
     RTN_LOGI(TAG, "Initializing mqtt");
 
-    char name[128] = {'\0'};
-    sprintf(name, "%x%x%x%x%x%x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    sprintf(m_username, "%x%x%x%x%x%x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    sprintf(m_topic, BROKER_TOPIC, DEVICE_ID);
+    sprintf(m_cmd_topic, CMD_TOPIC, DEVICE_ID);
+#if CONFIG_ENABLE_HISTORY
+    sprintf(m_history_topic, HISTORY_TOPIC, DEVICE_ID);
+#endif
+    sprintf(m_client_id, "%s-%02x%02x%02x%02x%02x%02x", DEVICE_ID, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    m_reconnect_ms = RECONNECT_MS + app_slot_offset(mac, CONFIG_PUBLISH_SLOT_SPREAD);
 
-    esp_mqtt_client_config_t mqtt_cfg = {
-        .host      = BROKER_HOST,
-        .port      = BROKER_PORT,
-        .client_id = DEVICE_ID,
-        .username  = name,
-        .password  = DEVICE_KEY,
-    };
+    m_window = xSemaphoreCreateCountingStatic(INFLIGHT_WINDOW, INFLIGHT_WINDOW, &m_window_buffer);
 
-    m_client = esp_mqtt_client_init(&mqtt_cfg);
-    esp_mqtt_client_register_event(m_client, ESP_EVENT_ANY_ID, mqtt_event_handler, m_client);
-    return esp_mqtt_client_start(m_client);
+    for (int i = 0; i < SESSIONS; i++) {
+        m_sessions[i].broker = -1;
+    }
+    if (app_broker_init(&m_brokers, BROKER_HOST, BROKER_PORT, FALLBACK_BROKERS) == 0) {
+        RTN_LOGE(TAG, "No valid broker");
+        return ESP_ERR_INVALID_ARG;
+    }
+    RTN_LOGI(TAG, "%u broker(s)", (unsigned)m_brokers.count);
+
+#if CONFIG_MQTT_FAILOVER
+    // the in-flight copies only serve a move to another broker, allocated once
+    if ((m_brokers.count > 1) && (m_copies == NULL)) {
+        m_copies = malloc(INFLIGHT_WINDOW * COPY_SIZE);
+        if (m_copies == NULL) {
+            RTN_LOGW(TAG, "No memory for the in-flight copies, messages are not handed off");
+        }
+    }
+#endif
+
+    // the standby session is opened by the first poll
+    return session_open(&m_sessions[m_active], 0);
 }
 
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+const app_transport_t app_mqtt_transport = {
+    .name         = "mqtt",
+    .start        = mqtt_start,
+    .send         = mqtt_send,
+    .poll         = mqtt_poll,
+    .stats        = mqtt_stats,
+    .send_tracked = mqtt_send_tracked,
+};
+
 /** @} */
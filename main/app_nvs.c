@@ -31,11 +31,8 @@ static const char* TAG = "app-nvs";
 #define WIFI_AP_SSID_KEY  "softap_ssid"
 #define WIFI_AP_PASS_KEY  "softap_pass"
 #define PERSON_COUNTER    "pers_count"
-
-/*===========================================================================*/
-/* Local variables.                                                          */
-/*===========================================================================*/
-static nvs_handle_t handle;
+#define APP_CONFIG        "app_config"
+#define RECORD_SEQ        "rec_seq"
 
 /**
  * @brief   Store WiFi configuration in NVS.
@@ -46,7 +43,8 @@ static nvs_handle_t handle;
  *
  */
 esp_err_t app_nvs_set_wifi(char* ssid, char* pass) {
-    esp_err_t ret = nvs_open("storage", NVS_READWRITE, &handle);
+    nvs_handle_t handle;
+    esp_err_t    ret = nvs_open("storage", NVS_READWRITE, &handle);
     if (ret != ESP_OK) {
         RTN_LOGE(TAG, "Cannot open Non-Volatile Storage");
         return ESP_FAIL;
@@ -76,7 +74,8 @@ esp_err_t app_nvs_set_wifi(char* ssid, char* pass) {
  *
  */
 esp_err_t app_nvs_set_ap(char* ssid, char* pass) {
-    esp_err_t ret = nvs_open("storage", NVS_READWRITE, &handle);
+    nvs_handle_t handle;
+    esp_err_t    ret = nvs_open("storage", NVS_READWRITE, &handle);
     if (ret != ESP_OK) {
         RTN_LOGE(TAG, "Cannot open Non-Volatile Storage");
         return ESP_FAIL;
@@ -105,7 +104,8 @@ esp_err_t app_nvs_set_ap(char* ssid, char* pass) {
  *
  */
 esp_err_t app_nvs_set_counter(uint16_t number) {
-    esp_err_t ret = nvs_open("storage", NVS_READWRITE, &handle);
+    nvs_handle_t handle;
+    esp_err_t    ret = nvs_open("storage", NVS_READWRITE, &handle);
     if (ret != ESP_OK) {
         RTN_LOGE(TAG, "Cannot open Non-Volatile Storage");
         return ESP_FAIL;
@@ -132,6 +132,7 @@ esp_err_t app_nvs_set_counter(uint16_t number) {
  *
  */
 uint16_t app_nvs_get_counter(void) {
+    nvs_handle_t handle;
     if (nvs_open("storage", NVS_READWRITE, &handle) != ESP_OK) {
         RTN_LOGE(TAG, "Cannot open Non-Volatile Storage");
         return 0;
@@ -144,6 +145,107 @@ uint16_t app_nvs_get_counter(void) {
     return count;
 }
 
+/**
+ * @brief   Store runtime configuration in NVS.
+ *
+ * @param[in] config    configuration pointer
+ * @param[in] length    configuration size
+ * @return              retrun msg
+ *
+ */
+esp_err_t app_nvs_set_config(const void* config, size_t length) {
+    nvs_handle_t handle;
+    esp_err_t    ret = nvs_open("storage", NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        RTN_LOGE(TAG, "Cannot open Non-Volatile Storage");
+        return ESP_FAIL;
+    }
+
+    esp_err_t ret1 = nvs_set_blob(handle, APP_CONFIG, config, length);
+
+    ret = nvs_commit(handle);
+    nvs_close(handle);
+
+    if ((ret == ESP_OK) && (ret1 == ESP_OK)) {
+        RTN_LOGI(TAG, "NVS configuration data set successfully");
+        return ESP_OK;
+    } else {
+        RTN_LOGI(TAG, "Failed to set NVS configuration data");
+        return ESP_FAIL;
+    }
+}
+
+/**
+ * @brief   Load runtime configuration from NVS.
+ *
+ * @param[out] config   configuration pointer
+ * @param[in] length    configuration size
+ * @return              retrun msg
+ *
+ */
+esp_err_t app_nvs_get_config(void* config, size_t length) {
+    nvs_handle_t handle;
+    if (nvs_open("storage", NVS_READWRITE, &handle) != ESP_OK) {
+        RTN_LOGE(TAG, "Cannot open Non-Volatile Storage");
+        return ESP_FAIL;
+    }
+
+    size_t    stored = length;
+    esp_err_t ret    = nvs_get_blob(handle, APP_CONFIG, config, &stored);
+
+    nvs_close(handle);
+    return ((ret == ESP_OK) && (stored == length)) ? ESP_OK : ESP_FAIL;
+}
+
+/**
+ * @brief   Store record sequence high-water mark in NVS.
+ *
+ * @param[in] seq   first sequence number not reserved
+ * @return          retrun msg
+ *
+ */
+esp_err_t app_nvs_set_seq(uint32_t seq) {
+    nvs_handle_t handle;
+    esp_err_t    ret = nvs_open("storage", NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        RTN_LOGE(TAG, "Cannot open Non-Volatile Storage");
+        return ESP_FAIL;
+    }
+
+    esp_err_t ret1 = nvs_set_u32(handle, RECORD_SEQ, seq);
+
+    ret = nvs_commit(handle);
+    nvs_close(handle);
+
+    if ((ret == ESP_OK) && (ret1 == ESP_OK)) {
+        RTN_LOGI(TAG, "NVS record sequence set to %u successfully", seq);
+        return ESP_OK;
+    } else {
+        RTN_LOGI(TAG, "Failed to set NVS record sequence");
+        return ESP_FAIL;
+    }
+}
+
+/**
+ * @brief   Load record sequence high-water mark from NVS.
+ *
+ * @return  first sequence number not reserved, 0 if none
+ *
+ */
+uint32_t app_nvs_get_seq(void) {
+    nvs_handle_t handle;
+    if (nvs_open("storage", NVS_READWRITE, &handle) != ESP_OK) {
+        RTN_LOGE(TAG, "Cannot open Non-Volatile Storage");
+        return 0;
+    }
+
+    uint32_t seq = 0;
+    nvs_get_u32(handle, RECORD_SEQ, &seq);
+
+    nvs_close(handle);
+    return seq;
+}
+
 /**
  * @brief   Initialize NVS.
  *
@@ -168,6 +270,7 @@ esp_err_t app_nvs_init(char* wifi_ssid, char* wifi_pass, char* ap_ssid, char* ap
     }
     ESP_ERROR_CHECK(ret);
 
+    nvs_handle_t handle;
     ret = nvs_open("storage", NVS_READWRITE, &handle);
     if (ret != ESP_OK) {
         RTN_LOGE(TAG, "Cannot open Non-Volatile Storage");
@@ -225,6 +225,18 @@ esp_err_t app_ota_write(const char* ota_data, const uint16_t length) {
     }
 }
 
+/**
+ * @brief   Abandon OTA image.
+ * @note    The image written so far is not booted, the boot partition is
+ *          left unchanged.
+ *
+ */
+void app_ota_abort(void) {
+    // no esp_ota_abort() before IDF v4.3, the handle is freed by esp_ota_end() whatever the image
+    esp_ota_end(update_handle);
+    update_handle = 0;
+}
+
 /**
  * @brief   Update OTA image.
  *
@@ -0,0 +1,58 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_payload.c
+ * @brief   Counter record encoding.
+ * @note    Pure C, no ESP-IDF dependency, the time conversion is given by the
+ *          caller so the encoding builds and runs on the host.
+ * @author  ael-mess
+ *
+ * @addtogroup NET
+ * @{
+ */
+
+#include "stdio.h"
+
+#include "app_payload.h"
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+/**
+ * @brief   Encode counter records.
+ * @note    A single record keeps the plain count format, several records are encoded as one batch.
+ *          Unsynchronized records carry milliseconds since boot.
+ *
+ * @param[out] buf      output buffer
+ * @param[in] len       output buffer size, 64 + count * APP_PAYLOAD_RECORD_SIZE is always enough
+ * @param[in] records   counter records
+ * @param[in] count     number of records
+ * @param[in] to_utc    monotonic to UTC time conversion
+ * @return              encoded length, 0 if the buffer is too small
+ *
+ */
+size_t app_payload_encode(char* buf, size_t len, const app_record_t* records, size_t count, app_payload_utc_t to_utc) {
+    int64_t ts;
+    bool    synced;
+    int     n;
+
+    if (count == 1) {
+        synced = to_utc(records[0].mono_us, &ts);
+        n      = snprintf(buf, len, "{ \"type\": \"count\", \"seq\": %u, \"value\": %d, \"ts\": %lld, \"sync\": %s }",
+                          (unsigned)records[0].seq, records[0].count, (long long)ts, synced ? "true" : "false");
+        return ((n > 0) && ((size_t)n < len)) ? (size_t)n : 0;
+    }
+
+    n = snprintf(buf, len, "{ \"type\": \"batch\", \"records\": [");
+    for (size_t i = 0; (i < count) && (n > 0) && ((size_t)n < len); i++) {
+        synced = to_utc(records[i].mono_us, &ts);
+        n += snprintf(buf + n, len - n, "%s{ \"seq\": %u, \"value\": %d, \"ts\": %lld, \"sync\": %s }", i ? ", " : "",
+                      (unsigned)records[i].seq, records[i].count, (long long)ts, synced ? "true" : "false");
+    }
+    if ((n > 0) && ((size_t)n < len)) {
+        n += snprintf(buf + n, len - n, "] }");
+    }
+    return ((n > 0) && ((size_t)n < len)) ? (size_t)n : 0;
+}
+
+/** @} */
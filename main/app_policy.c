@@ -0,0 +1,108 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_policy.c
+ * @brief   Publish policy.
+ * @note    Pure C, no ESP-IDF dependency. A sample is published as soon as the
+ *          counter moved by the deadband since the last publish, no sooner than
+ *          the minimum spacing, and otherwise once per heartbeat interval.
+ * @author  ael-mess
+ *
+ * @addtogroup MAIN
+ * @{
+ */
+
+#include "stdio.h"
+#include "string.h"
+
+#include "app_policy.h"
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static app_policy_decision_t policy_send(app_policy_t* p, app_policy_decision_t decision, uint16_t count,
+                                         int64_t now_us) {
+    p->started    = true;
+    p->pending    = false;
+    p->last_count = count;
+    p->last_us    = now_us;
+
+    p->stats.sent++;
+    if (decision == APP_POLICY_CHANGE) {
+        p->stats.changes++;
+    } else {
+        p->stats.heartbeats++;
+    }
+    return decision;
+}
+
+/**
+ * @brief   Initialize policy state.
+ *
+ * @param[out] p    policy state pointer
+ *
+ */
+void app_policy_init(app_policy_t* p) { memset(p, 0, sizeof(app_policy_t)); }
+
+/**
+ * @brief   Decide whether a sample is published.
+ * @note    The first sample is always published. A change held back by the
+ *          minimum spacing is published with the latest counter once the
+ *          spacing elapsed, unless the counter came back within the deadband.
+ *
+ * @param[in,out] p     policy state pointer
+ * @param[in] config    policy thresholds
+ * @param[in] count     sampled counter
+ * @param[in] now_us    sample time, monotonic clock
+ * @return              retrun decision, the sample is published unless APP_POLICY_SUPPRESS
+ *
+ */
+app_policy_decision_t app_policy_check(app_policy_t* p, const app_policy_config_t* config, uint16_t count,
+                                       int64_t now_us) {
+    p->stats.samples++;
+
+    if (!p->started || (config->deadband == 0)) {
+        return policy_send(p, APP_POLICY_CHANGE, count, now_us);
+    }
+
+    int64_t  elapsed_ms = (now_us - p->last_us) / 1000;
+    uint16_t delta      = (count > p->last_count) ? count - p->last_count : p->last_count - count;
+    if (delta >= config->deadband) {
+        if (elapsed_ms >= config->min_ms) {
+            return policy_send(p, APP_POLICY_CHANGE, count, now_us);
+        }
+        if (!p->pending) {
+            p->pending = true;
+            p->stats.deferred++;
+        }
+    } else {
+        p->pending = false;
+    }
+
+    if (elapsed_ms >= config->heartbeat_ms) {
+        return policy_send(p, APP_POLICY_HEARTBEAT, count, now_us);
+    }
+
+    p->stats.suppressed++;
+    return APP_POLICY_SUPPRESS;
+}
+
+/**
+ * @brief   Encode policy statistics record.
+ *
+ * @param[in] stats     statistics pointer
+ * @param[out] buf      output buffer
+ * @param[in] len       output buffer size
+ * @return              encoded length, 0 if the buffer is too small
+ *
+ */
+size_t app_policy_encode(const app_policy_stats_t* stats, char* buf, size_t len) {
+    int n = snprintf(buf, len,
+                     "{ \"type\": \"policy\", \"samples\": %u, \"sent\": %u, \"changes\": %u, \"heartbeats\": %u, "
+                     "\"suppressed\": %u, \"deferred\": %u }",
+                     (unsigned)stats->samples, (unsigned)stats->sent, (unsigned)stats->changes,
+                     (unsigned)stats->heartbeats, (unsigned)stats->suppressed, (unsigned)stats->deferred);
+    return ((n > 0) && ((size_t)n < len)) ? (size_t)n : 0;
+}
+
+/** @} */
@@ -0,0 +1,474 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_relay.c
+ * @brief   Counter record relay between leaves and a gateway.
+ * @note    Pure C, no ESP-IDF dependency, frames go through the
+ *          app_relay_link_t operations (ESP-NOW on target, UDP on the host).
+ *          A leaf sends its records in compact data frames, one frame in
+ *          flight, sent again with a doubling delay until acknowledged. The
+ *          gateway drops the records it already has, batches the others with
+ *          the records of other leaves and publishes them upstream. A leaf is
+ *          acknowledged once the upstream reports its records delivered (MQTT
+ *          PUBACK), with the last sequence number delivered, so a lost frame,
+ *          acknowledge or upstream message only delays the records: after a
+ *          message is lost, the gateway takes again every record not yet
+ *          acknowledged. A message whose report does not come in time, or
+ *          whose token is given again to a later message, is taken as lost:
+ *          a dropped report delays the leaves, at the cost of records
+ *          delivered twice, instead of stalling them. Records carry their age, the gateway stamps them with
+ *          its own clock.
+ *          Data frame: magic, type, record count, 0, then per record its
+ *          sequence number (4 bytes), counter (2 bytes) and age in ms
+ *          (4 bytes), little endian. Acknowledge: magic, type, 1 if a record
+ *          was taken, 0, last sequence number taken.
+ * @author  ael-mess
+ *
+ * @addtogroup NET
+ * @{
+ */
+
+#include "stdio.h"
+#include "string.h"
+
+#include "app_relay.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define FRAME_MAGIC  0xC7
+#define FRAME_DATA   1
+#define FRAME_ACK    2
+#define HEADER_SIZE  4
+#define RECORD_SIZE  10
+#define ACK_SIZE     8
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static void put_u16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t* p, uint32_t v) {
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get_u16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+static uint32_t get_u32(const uint8_t* p) { return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16); }
+
+static bool seq_after(uint32_t a, uint32_t b) { return (int32_t)(a - b) > 0; }
+
+static void leaf_send(app_relay_leaf_t* leaf, int64_t now_us) {
+    uint8_t frame[APP_RELAY_FRAME_SIZE];
+    size_t  n = (leaf->count < APP_RELAY_FRAME_RECORDS) ? leaf->count : APP_RELAY_FRAME_RECORDS;
+
+    frame[0] = FRAME_MAGIC;
+    frame[1] = FRAME_DATA;
+    frame[2] = (uint8_t)n;
+    frame[3] = 0;
+    for (size_t i = 0; i < n; i++) {
+        const app_record_t* r   = &leaf->queue[(leaf->head + i) % APP_RELAY_QUEUE];
+        uint8_t*            p   = &frame[HEADER_SIZE + i * RECORD_SIZE];
+        int64_t             age = (now_us - r->mono_us) / 1000;
+        put_u32(p, r->seq);
+        put_u16(p + 4, r->count);
+        put_u32(p + 6, (age < 0) ? 0 : (age > UINT32_MAX) ? UINT32_MAX : (uint32_t)age);
+    }
+
+    size_t len = HEADER_SIZE + n * RECORD_SIZE;
+    leaf->link.send(leaf->link.ctx, leaf->gateway, frame, len);
+    leaf->inflight = n;
+    leaf->stats.frames++;
+    leaf->stats.tx_bytes += len;
+}
+
+static void leaf_ack(app_relay_leaf_t* leaf, const uint8_t* frame, size_t len) {
+    if ((len < ACK_SIZE) || (frame[0] != FRAME_MAGIC) || (frame[1] != FRAME_ACK) || !frame[2]) {
+        return;
+    }
+
+    uint32_t seq    = get_u32(&frame[4]);
+    size_t   popped = 0;
+    while ((leaf->count > 0) && !seq_after(leaf->queue[leaf->head].seq, seq)) {
+        leaf->head = (leaf->head + 1) % APP_RELAY_QUEUE;
+        leaf->count--;
+        popped++;
+    }
+
+    // a stale acknowledge leaves the frame in flight
+    if (popped > 0) {
+        leaf->stats.acked += popped;
+        leaf->inflight = 0;
+    }
+}
+
+static void gateway_ack(app_relay_gateway_t* gw, const app_relay_peer_t* peer) {
+    uint8_t frame[ACK_SIZE] = {FRAME_MAGIC, FRAME_ACK, peer->acked, 0};
+    put_u32(&frame[4], peer->acked_seq);
+    gw->link.send(gw->link.ctx, peer->mac, frame, sizeof(frame));
+    gw->stats.acks++;
+}
+
+static app_relay_peer_t* gateway_peer(app_relay_gateway_t* gw, const uint8_t mac[6]) {
+    for (size_t i = 0; i < gw->peers_count; i++) {
+        if (memcmp(gw->peers[i].mac, mac, 6) == 0) {
+            return &gw->peers[i];
+        }
+    }
+    if (gw->peers_count == APP_RELAY_MAX_LEAVES) {
+        return NULL;
+    }
+
+    app_relay_peer_t* peer = &gw->peers[gw->peers_count++];
+    memset(peer, 0, sizeof(*peer));
+    memcpy(peer->mac, mac, 6);
+    return peer;
+}
+
+static size_t gateway_encode_batch(app_relay_gateway_t* gw) {
+    size_t len = sizeof(gw->buf);
+    int    n   = snprintf(gw->buf, len, "{ \"type\": \"relay\", \"records\": [");
+
+    for (size_t i = 0; (i < gw->count) && (n > 0) && ((size_t)n < len); i++) {
+        const app_relay_entry_t* e = &gw->entries[i];
+        const uint8_t*           m = gw->peers[e->peer].mac;
+        int64_t                  ts;
+        bool                     synced = gw->to_utc(e->record.mono_us, &ts);
+        n += snprintf(gw->buf + n, len - n,
+                      "%s{ \"leaf\": \"%02x%02x%02x%02x%02x%02x\", \"seq\": %u, \"value\": %u, \"ts\": %lld, "
+                      "\"sync\": %s }",
+                      i ? ", " : "", m[0], m[1], m[2], m[3], m[4], m[5], (unsigned)e->record.seq,
+                      (unsigned)e->record.count, (long long)ts, synced ? "true" : "false");
+    }
+    if ((n > 0) && ((size_t)n < len)) {
+        n += snprintf(gw->buf + n, len - n, "] }");
+    }
+    return ((n > 0) && ((size_t)n < len)) ? (size_t)n : 0;
+}
+
+static void gateway_rewind(app_relay_gateway_t* gw) {
+    // the leaves send again what is not acknowledged, the messages still pending may reach the upstream twice
+    gw->stats.lost++;
+    gw->pending_count = 0;
+    gw->count         = 0;
+    for (size_t i = 0; i < gw->peers_count; i++) {
+        app_relay_peer_t* peer = &gw->peers[i];
+        peer->seen             = peer->acked;
+        peer->last_seq         = peer->acked_seq;
+    }
+}
+
+static void gateway_settle(app_relay_gateway_t* gw) {
+    // in publish order, a leaf acknowledge covers all its earlier records
+    while (gw->pending_count > 0) {
+        const app_relay_pending_t* p = &gw->pending[gw->pending_head];
+        if (!p->reported) {
+            return;
+        }
+        if (!p->delivered) {
+            gateway_rewind(gw);
+            return;
+        }
+        gw->pending_head = (gw->pending_head + 1) % APP_RELAY_PENDING;
+        gw->pending_count--;
+
+        for (size_t i = 0; i < gw->peers_count; i++) {
+            app_relay_peer_t* peer = &gw->peers[i];
+            if (p->peers & (1u << i)) {
+                peer->acked     = true;
+                peer->acked_seq = p->seq[i];
+                gateway_ack(gw, peer);
+            }
+        }
+    }
+}
+
+static void gateway_flush(app_relay_gateway_t* gw, int64_t now_us) {
+    int token = -1;
+    if ((gw->pending_count == APP_RELAY_PENDING) || (gateway_encode_batch(gw) == 0) ||
+        (gw->publish(gw->publish_ctx, gw->buf, &token) != 0)) {
+        gw->stats.deferred++;
+        return;
+    }
+    gw->stats.messages++;
+
+    app_relay_pending_t* p = &gw->pending[(gw->pending_head + gw->pending_count++) % APP_RELAY_PENDING];
+    p->token               = token;
+    p->reported            = (token < 0);
+    p->delivered           = (token < 0);
+    p->sent_us             = now_us;
+    p->peers               = 0;
+    for (size_t i = 0; i < gw->count; i++) {
+        const app_relay_entry_t* e = &gw->entries[i];
+        p->peers |= 1u << e->peer;
+        p->seq[e->peer] = e->record.seq;
+    }
+    gw->count = 0;
+
+    // the token was free again, the report of an earlier message holding it was dropped
+    for (size_t i = 0; (token >= 0) && (i + 1 < gw->pending_count); i++) {
+        app_relay_pending_t* q = &gw->pending[(gw->pending_head + i) % APP_RELAY_PENDING];
+        if (!q->reported && (q->token == token)) {
+            gw->stats.unreported++;
+            q->reported  = true;
+            q->delivered = false;
+        }
+    }
+    gateway_settle(gw);
+}
+
+static void gateway_frame(app_relay_gateway_t* gw, const uint8_t mac[6], const uint8_t* frame, size_t len,
+                          int64_t now_us) {
+    if ((len < HEADER_SIZE) || (frame[0] != FRAME_MAGIC) || (frame[1] != FRAME_DATA) ||
+        (frame[2] > APP_RELAY_FRAME_RECORDS) || (len != (size_t)HEADER_SIZE + frame[2] * RECORD_SIZE)) {
+        gw->stats.invalid++;
+        return;
+    }
+
+    gw->stats.frames++;
+    app_relay_peer_t* peer = gateway_peer(gw, mac);
+    if (peer == NULL) {
+        gw->stats.refused += frame[2];
+        return;
+    }
+
+    bool again = false;
+    for (size_t i = 0; i < frame[2]; i++) {
+        const uint8_t* p   = &frame[HEADER_SIZE + i * RECORD_SIZE];
+        uint32_t       seq = get_u32(p);
+        if (peer->seen && !seq_after(seq, peer->last_seq)) {
+            peer->duplicates++;
+            gw->stats.duplicates++;
+            again = true;
+            continue;
+        }
+        if (gw->count >= gw->batch) {
+            gateway_flush(gw, now_us);
+        }
+        // records are taken in order, the leaf sends the rest again
+        if (gw->count >= gw->batch) {
+            gw->stats.refused += frame[2] - i;
+            break;
+        }
+
+        app_relay_entry_t* e = &gw->entries[gw->count];
+        e->peer              = (uint8_t)(peer - gw->peers);
+        e->record.seq        = seq;
+        e->record.count      = get_u16(p + 4);
+        e->record.mono_us    = now_us - (int64_t)get_u32(p + 6) * 1000;
+        gw->first_us         = (gw->count == 0) ? now_us : gw->first_us;
+        gw->count++;
+        peer->seen     = true;
+        peer->last_seq = seq;
+        peer->records++;
+        gw->stats.records++;
+    }
+
+    // records sent again, the leaf may have lost an acknowledge
+    if (again && peer->acked) {
+        gateway_ack(gw, peer);
+    }
+}
+
+/**
+ * @brief   Initialize a leaf.
+ *
+ * @param[out] leaf     leaf state
+ * @param[in] link      frame link
+ * @param[in] gateway   gateway address
+ * @param[in] retry_ms  first retransmission delay
+ *
+ */
+void app_relay_leaf_init(app_relay_leaf_t* leaf, const app_relay_link_t* link, const uint8_t gateway[6],
+                         uint32_t retry_ms) {
+    memset(leaf, 0, sizeof(*leaf));
+    leaf->link     = *link;
+    leaf->retry_ms = retry_ms;
+    memcpy(leaf->gateway, gateway, 6);
+}
+
+/**
+ * @brief   Queue counter records for the gateway.
+ *
+ * @param[in,out] leaf  leaf state
+ * @param[in] records   counter records, in sequence order
+ * @param[in] count     number of records
+ * @return              0 on success, -1 if the queue cannot take them all, none is queued then
+ *
+ */
+int app_relay_leaf_push(app_relay_leaf_t* leaf, const app_record_t* records, size_t count) {
+    if (leaf->count + count > APP_RELAY_QUEUE) {
+        leaf->stats.throttled++;
+        return -1;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        leaf->queue[(leaf->head + leaf->count++) % APP_RELAY_QUEUE] = records[i];
+    }
+    return 0;
+}
+
+/**
+ * @brief   Process acknowledges, send and retransmit data frames.
+ *
+ * @param[in,out] leaf  leaf state
+ * @param[in] now_us    monotonic time
+ *
+ */
+void app_relay_leaf_poll(app_relay_leaf_t* leaf, int64_t now_us) {
+    uint8_t frame[APP_RELAY_FRAME_SIZE];
+    uint8_t peer[6];
+    int     len;
+
+    while ((len = leaf->link.recv(leaf->link.ctx, peer, frame, sizeof(frame))) > 0) {
+        if (memcmp(peer, leaf->gateway, 6) == 0) {
+            leaf_ack(leaf, frame, (size_t)len);
+        }
+    }
+
+    if (leaf->count == 0) {
+        leaf->inflight = 0;
+        return;
+    }
+
+    if (leaf->inflight == 0) {
+        leaf->backoff_ms = leaf->retry_ms;
+    } else if (now_us >= leaf->retry_us) {
+        // the frame or its acknowledge is lost, or the gateway is busy
+        leaf->stats.retransmits++;
+        uint32_t max     = leaf->retry_ms * APP_RELAY_RETRY_MAX;
+        leaf->backoff_ms = (leaf->backoff_ms * 2 < max) ? leaf->backoff_ms * 2 : max;
+    } else {
+        return;
+    }
+    leaf_send(leaf, now_us);
+    leaf->retry_us = now_us + (int64_t)leaf->backoff_ms * 1000;
+}
+
+/**
+ * @brief   Encode leaf statistics record.
+ *
+ * @param[in] leaf      leaf state
+ * @param[out] buf      output buffer
+ * @param[in] len       output buffer size
+ * @return              encoded length, 0 if the buffer is too small
+ *
+ */
+size_t app_relay_leaf_encode(const app_relay_leaf_t* leaf, char* buf, size_t len) {
+    int n = snprintf(buf, len,
+                     "{ \"type\": \"leaf\", \"queued\": %u, \"frames\": %u, \"retransmits\": %u, \"acked\": %u, "
+                     "\"throttled\": %u, \"tx_bytes\": %u }",
+                     (unsigned)leaf->count, (unsigned)leaf->stats.frames, (unsigned)leaf->stats.retransmits,
+                     (unsigned)leaf->stats.acked, (unsigned)leaf->stats.throttled, (unsigned)leaf->stats.tx_bytes);
+    return ((n > 0) && ((size_t)n < len)) ? (size_t)n : 0;
+}
+
+/**
+ * @brief   Initialize a gateway.
+ *
+ * @param[out] gw           gateway state
+ * @param[in] link          frame link
+ * @param[in] publish       upstream publish
+ * @param[in] publish_ctx   upstream publish context
+ * @param[in] to_utc        monotonic to UTC time conversion
+ * @param[in] batch         records per upstream message (max APP_RELAY_MAX_BATCH)
+ * @param[in] delay_ms      max time a record waits for a full batch
+ * @param[in] report_ms     max time a message waits for its delivery report, past the upstream expiry
+ *
+ */
+void app_relay_gateway_init(app_relay_gateway_t* gw, const app_relay_link_t* link, app_relay_publish_t publish,
+                            void* publish_ctx, app_payload_utc_t to_utc, uint32_t batch, uint32_t delay_ms,
+                            uint32_t report_ms) {
+    memset(gw, 0, sizeof(*gw));
+    gw->link        = *link;
+    gw->publish     = publish;
+    gw->publish_ctx = publish_ctx;
+    gw->to_utc      = to_utc;
+    gw->batch       = ((batch > 0) && (batch <= APP_RELAY_MAX_BATCH)) ? batch : APP_RELAY_MAX_BATCH;
+    gw->delay_ms    = delay_ms;
+    gw->report_ms   = report_ms;
+}
+
+/**
+ * @brief   Take the received frames and publish full or expired batches.
+ * @note    The oldest message still without delivery report past report_ms
+ *          is taken as lost.
+ *
+ * @param[in,out] gw    gateway state
+ * @param[in] now_us    monotonic time
+ *
+ */
+void app_relay_gateway_poll(app_relay_gateway_t* gw, int64_t now_us) {
+    uint8_t frame[APP_RELAY_FRAME_SIZE];
+    uint8_t mac[6];
+    int     len;
+
+    const app_relay_pending_t* oldest = &gw->pending[gw->pending_head];
+    if ((gw->pending_count > 0) && ((now_us - oldest->sent_us) >= (int64_t)gw->report_ms * 1000)) {
+        gw->stats.unreported++;
+        gateway_rewind(gw);
+    }
+
+    while ((len = gw->link.recv(gw->link.ctx, mac, frame, sizeof(frame))) > 0) {
+        gw->stats.rx_bytes += len;
+        gateway_frame(gw, mac, frame, (size_t)len, now_us);
+        if (gw->count >= gw->batch) {
+            gateway_flush(gw, now_us);
+        }
+    }
+
+    if ((gw->count > 0) && ((gw->count >= gw->batch) || ((now_us - gw->first_us) >= (int64_t)gw->delay_ms * 1000))) {
+        gateway_flush(gw, now_us);
+    }
+}
+
+/**
+ * @brief   Report the delivery of an upstream message.
+ * @note    The leaves are acknowledged once their messages are delivered, in
+ *          publish order. A message not delivered makes the gateway take
+ *          again every record not acknowledged.
+ *
+ * @param[in,out] gw    gateway state
+ * @param[in] token     token given by the upstream publish
+ * @param[in] delivered true if the message reached the upstream
+ *
+ */
+void app_relay_gateway_report(app_relay_gateway_t* gw, int token, bool delivered) {
+    for (size_t i = 0; i < gw->pending_count; i++) {
+        app_relay_pending_t* p = &gw->pending[(gw->pending_head + i) % APP_RELAY_PENDING];
+        if (!p->reported && (p->token == token)) {
+            p->reported  = true;
+            p->delivered = delivered;
+            break;
+        }
+    }
+    gateway_settle(gw);
+}
+
+/**
+ * @brief   Encode gateway statistics record.
+ *
+ * @param[in] gw        gateway state
+ * @param[out] buf      output buffer
+ * @param[in] len       output buffer size
+ * @return              encoded length, 0 if the buffer is too small
+ *
+ */
+size_t app_relay_gateway_encode(const app_relay_gateway_t* gw, char* buf, size_t len) {
+    int n = snprintf(buf, len,
+                     "{ \"type\": \"gateway\", \"leaves\": %u, \"frames\": %u, \"records\": %u, \"duplicates\": %u, "
+                     "\"refused\": %u, \"invalid\": %u, \"messages\": %u, \"deferred\": %u, \"lost\": %u, "
+                     "\"unreported\": %u, \"pending\": %u, \"acks\": %u, \"rx_bytes\": %u }",
+                     (unsigned)gw->peers_count, (unsigned)gw->stats.frames, (unsigned)gw->stats.records,
+                     (unsigned)gw->stats.duplicates, (unsigned)gw->stats.refused, (unsigned)gw->stats.invalid,
+                     (unsigned)gw->stats.messages, (unsigned)gw->stats.deferred, (unsigned)gw->stats.lost,
+                     (unsigned)gw->stats.unreported, (unsigned)gw->pending_count, (unsigned)gw->stats.acks,
+                     (unsigned)gw->stats.rx_bytes);
+    return ((n > 0) && ((size_t)n < len)) ? (size_t)n : 0;
+}
+
+/** @} */
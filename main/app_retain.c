@@ -0,0 +1,106 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_retain.c
+ * @brief   RTC memory counter retention.
+ * @author  ael-mess
+ *
+ * @addtogroup IN
+ * @{
+ */
+
+#include "stddef.h"
+
+#include "esp_system.h"
+#include "esp_attr.h"
+#include "esp32/rom/crc.h"
+
+#include "freertos/FreeRTOS.h"
+
+#include "app_nvs.h"
+#include "app_retain.h"
+
+#include "app_log.h"
+#if CONFIG_ENABLE_LOGGING
+static const char* TAG = "app-retain";
+#endif
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define RETAIN_MAGIC 0x50435254 /* "PCRT" */
+
+typedef struct {
+    uint32_t magic;
+    uint32_t generation; /* incremented on each store */
+    uint16_t count;
+    uint16_t reserved;
+    uint32_t crc; /* CRC32 of the fields above */
+} retain_t;
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+// RTC slow memory, kept across software, watchdog and deep sleep resets, lost on power-on
+static RTC_NOINIT_ATTR retain_t m_retain;
+static portMUX_TYPE            m_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static uint32_t retain_crc(const retain_t* retain) {
+    return crc32_le(0, (const uint8_t*)retain, offsetof(retain_t, crc));
+}
+
+static bool retain_is_valid(const retain_t* retain) {
+    return (retain->magic == RETAIN_MAGIC) && (retain->crc == retain_crc(retain));
+}
+
+/**
+ * @brief   Restore person counter.
+ * @note    RTC memory is used when valid, NVS otherwise. After a brownout the
+ *          power is failing, the retained counter is flushed to NVS only then.
+ *
+ * @return  restored person counter
+ *
+ */
+uint16_t app_retain_restore(void) {
+    esp_reset_reason_t reason = esp_reset_reason();
+
+    if (!retain_is_valid(&m_retain)) {
+        uint16_t count = app_nvs_get_counter();
+        RTN_LOGI(TAG, "RTC counter invalid (reset %d), restored %u from NVS", reason, count);
+
+        m_retain.magic      = RETAIN_MAGIC;
+        m_retain.generation = 0;
+        m_retain.count      = count;
+        m_retain.reserved   = 0;
+        m_retain.crc        = retain_crc(&m_retain);
+        return count;
+    }
+
+    RTN_LOGI(TAG, "RTC counter %u restored (generation %u, reset %d)", m_retain.count, m_retain.generation, reason);
+    if (reason == ESP_RST_BROWNOUT) {
+        app_nvs_set_counter(m_retain.count);
+    }
+    return m_retain.count;
+}
+
+/**
+ * @brief   Retain person counter.
+ * @note    Costs a RAM write only, no flash access.
+ *
+ * @param[in] count person counter
+ *
+ */
+void app_retain_store(uint16_t count) {
+    portENTER_CRITICAL(&m_lock);
+    if (m_retain.count != count) {
+        m_retain.generation++;
+        m_retain.count = count;
+        m_retain.crc   = retain_crc(&m_retain);
+    }
+    portEXIT_CRITICAL(&m_lock);
+}
+
+/** @} */
@@ -3,14 +3,28 @@
  *
  * @file    app_sensor.c
  * @brief   Sensor driver.
+ * @note    With the ToF sensor, a task pinned to the application core runs the
+ *          depth frames through the segmentation and the tracker at the frame
+ *          rate, the counter follows the line crossings (entries minus exits).
  * @author  ael-mess
  *
  * @addtogroup HW
  * @{
  */
 
+#include "stdbool.h"
+
 #include "esp_err.h"
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "app_sensor.h"
+#include "app_scene.h"
+#include "app_tof.h"
+#include "app_track.h"
+#include "app_sys.h"
+
 #include "app_log.h"
 #if CONFIG_ENABLE_LOGGING
 static const char* TAG = "app_sensor";
@@ -20,6 +34,72 @@ static const char* TAG = "app_sensor";
 #error "No sensor found for the moment, dummy data need to be enabled"
 #endif
 
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define SCENE_SEED 1
+
+#if CONFIG_USE_TOF && (CONFIG_TOF_FRAME_RATE > configTICK_RATE_HZ)
+#error "TOF_FRAME_RATE above the FreeRTOS tick rate"
+#endif
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static uint16_t     m_count = UINT16_MAX; /* first dummy read gives 0 */
+static bool         m_restored;           /* next dummy read gives the restored counter as is */
+static portMUX_TYPE m_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#if CONFIG_USE_TOF
+static app_scene_t       m_scene;
+static app_tof_t         m_tof;
+static app_track_t       m_track;
+static app_track_stats_t m_stats; /* tracker statistics, under m_lock */
+static StaticTask_t      m_tof_tcb;
+static StackType_t       m_tof_stack[CONFIG_TOF_STACK];
+#endif
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+#if CONFIG_USE_TOF
+static void tof_task(void* arg) {
+    TickType_t second = xTaskGetTickCount(); /* start of the current second */
+    TickType_t wake   = second;
+    uint32_t   frame  = 0;                   /* within the current second */
+
+    while (true) {
+        uint16_t          depth[APP_TOF_PIXELS];
+        app_tof_blob_t    blobs[APP_TOF_MAX_BLOBS];
+        app_track_event_t events[APP_TRACK_MAX];
+
+        app_scene_frame(&m_scene, depth);
+        size_t count = app_tof_process(&m_tof, depth, blobs, APP_TOF_MAX_BLOBS);
+
+        count = app_track_update(&m_track, blobs, count, events, APP_TRACK_MAX);
+
+        portENTER_CRITICAL(&m_lock);
+        m_stats = m_track.stats;
+        for (size_t i = 0; i < count; i++) {
+            if ((events[i].dir == APP_TRACK_IN) && (m_count < UINT16_MAX)) {
+                m_count++;
+            } else if ((events[i].dir == APP_TRACK_OUT) && (m_count > 0)) {
+                m_count--;
+            }
+        }
+        portEXIT_CRITICAL(&m_lock);
+
+        // deadlines from the frame number, a rate not dividing the tick rate alternates whole tick periods
+        if (++frame == CONFIG_TOF_FRAME_RATE) {
+            second += configTICK_RATE_HZ;
+            frame = 0;
+        }
+        TickType_t next = second + (TickType_t)((frame * configTICK_RATE_HZ) / CONFIG_TOF_FRAME_RATE);
+        vTaskDelayUntil(&wake, next - wake);
+    }
+}
+#endif
+
 /**
  * @brief   Initialize sensor.
  *
@@ -29,6 +109,19 @@ static const char* TAG = "app_sensor";
 esp_err_t app_sensor_init(void) {
     RTN_LOGI(TAG, "Initializing sensor");
 
+#if CONFIG_USE_TOF
+    app_scene_init(&m_scene, SCENE_SEED, CONFIG_TOF_FRAME_RATE);
+    app_tof_init(&m_tof);
+    app_track_init(&m_track);
+
+    // frames are processed on the application core, away from the WiFi stack
+    if (xTaskCreateStaticPinnedToCore(tof_task, APP_SYS_TOF_TASK, CONFIG_TOF_STACK, NULL, CONFIG_TOF_PRIORITY,
+                                      m_tof_stack, &m_tof_tcb, portNUM_PROCESSORS - 1) == NULL) {
+        RTN_LOGE(TAG, "Failed to start the depth frame task");
+        return ESP_FAIL;
+    }
+#endif
+
     return ESP_OK;
 }
 
@@ -38,11 +131,50 @@ esp_err_t app_sensor_init(void) {
  * @return  retrun person count
  *
  */
-uint8_t app_sensor_get_count(void) {
-    static uint8_t count = 0xff;
-    count++;
+uint16_t app_sensor_get_count(void) {
+    portENTER_CRITICAL(&m_lock);
+#if CONFIG_USE_TOF
+    uint16_t count = m_count;
+#else
+    uint16_t count = m_restored ? m_count : ++m_count;
+    m_restored     = false;
+#endif
+    portEXIT_CRITICAL(&m_lock);
 
     return count;
 }
 
+/**
+ * @brief   Restore person counter.
+ *
+ * @param[in] count last person count read before reset
+ *
+ */
+void app_sensor_set_count(uint16_t count) {
+    portENTER_CRITICAL(&m_lock);
+    m_count    = count;
+    m_restored = true;
+    portEXIT_CRITICAL(&m_lock);
+}
+
+/**
+ * @brief   Encode sensor statistics record.
+ *
+ * @param[out] buf  output buffer
+ * @param[in] len   output buffer size
+ * @return          encoded length, 0 without statistics or if the buffer is too small
+ *
+ */
+size_t app_sensor_stats(char* buf, size_t len) {
+#if CONFIG_USE_TOF
+    portENTER_CRITICAL(&m_lock);
+    app_track_stats_t stats = m_stats;
+    portEXIT_CRITICAL(&m_lock);
+
+    return app_track_encode(&stats, buf, len);
+#else
+    return 0;
+#endif
+}
+
 /** @} */
@@ -0,0 +1,126 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_seq.c
+ * @brief   Record sequence numbers.
+ * @note    Sequence numbers increase across reboots and are never reused. NVS
+ *          holds a high-water mark reserved CONFIG_SEQ_BLOCK numbers ahead, so
+ *          flash is written once per block. The next number is also kept in
+ *          RTC memory: a software or watchdog reset resumes exactly, a power
+ *          loss resumes at the high-water mark and skips the unused numbers
+ *          of the block. No number is issued past the stored high-water mark,
+ *          while the reservation cannot be written numbering stops.
+ * @author  ael-mess
+ *
+ * @addtogroup IN
+ * @{
+ */
+
+#include "stddef.h"
+
+#include "esp_system.h"
+#include "esp_attr.h"
+#include "esp32/rom/crc.h"
+
+#include "app_nvs.h"
+#include "app_seq.h"
+
+#include "app_log.h"
+#if CONFIG_ENABLE_LOGGING
+static const char* TAG = "app-seq";
+#endif
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define SEQ_BLOCK CONFIG_SEQ_BLOCK
+#define SEQ_MAGIC 0x50435351 /* "PCSQ" */
+
+typedef struct {
+    uint32_t magic;
+    uint32_t next;
+    uint32_t crc; /* CRC32 of the fields above */
+} seq_retain_t;
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static RTC_NOINIT_ATTR seq_retain_t m_retain;
+static uint32_t                     m_next;
+static uint32_t                     m_hwm; /* first number not reserved in NVS */
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static uint32_t seq_crc(const seq_retain_t* retain) {
+    return crc32_le(0, (const uint8_t*)retain, offsetof(seq_retain_t, crc));
+}
+
+static void seq_reserve(void) {
+    // a failed write is retried by app_seq_ready(), numbers past the stored mark would be issued again after a power
+    // loss
+    if (app_nvs_set_seq(m_next + SEQ_BLOCK) == ESP_OK) {
+        m_hwm = m_next + SEQ_BLOCK;
+    } else {
+        RTN_LOGE(TAG, "Cannot reserve sequence block at %u", m_next);
+    }
+}
+
+/**
+ * @brief   Restore record sequence.
+ *
+ * @return  first sequence number of this boot
+ *
+ */
+uint32_t app_seq_init(void) {
+    m_hwm  = app_nvs_get_seq();
+    m_next = m_hwm;
+
+    // the retained number is trusted only inside the reserved range
+    if ((m_retain.magic == SEQ_MAGIC) && (m_retain.crc == seq_crc(&m_retain)) && (m_retain.next <= m_hwm) &&
+        (m_hwm - m_retain.next <= SEQ_BLOCK)) {
+        m_next = m_retain.next;
+    }
+    RTN_LOGI(TAG, "Record sequence resumes at %u, reserved up to %u", m_next, m_hwm);
+
+    if (m_next >= m_hwm) {
+        seq_reserve();
+    }
+    return m_next;
+}
+
+/**
+ * @brief   Check a sequence number can be taken.
+ * @note    Retries a failed reservation. Not thread safe, called from the sampling task only.
+ *
+ * @return  retrun true if the next number is reserved in NVS
+ *
+ */
+bool app_seq_ready(void) {
+    if (m_next >= m_hwm) {
+        seq_reserve();
+    }
+    return m_next < m_hwm;
+}
+
+/**
+ * @brief   Take the next sequence number.
+ * @note    Only after app_seq_ready() returned true. Not thread safe, called from the sampling task only.
+ *
+ * @return  sequence number
+ *
+ */
+uint32_t app_seq_next(void) {
+    uint32_t seq = m_next++;
+
+    m_retain.magic = SEQ_MAGIC;
+    m_retain.next  = m_next;
+    m_retain.crc   = seq_crc(&m_retain);
+
+    if (m_next >= m_hwm) {
+        seq_reserve();
+    }
+    return seq;
+}
+
+/** @} */
@@ -0,0 +1,413 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_series.c
+ * @brief   Flash time-series store.
+ * @note    Pure C, no ESP-IDF dependency, the flash is reached through the
+ *          app_series_flash_t operations. Points are appended to fixed size
+ *          blocks used as a ring over the partition, the oldest sector is
+ *          erased when the ring wraps. A block header holds the first point,
+ *          each following point is one byte of minute delta and the zigzag
+ *          varint of the value delta, 2 bytes for a steady counter. The first
+ *          minute of every block is kept in RAM, a range lookup is a binary
+ *          search over them. Points are programmed as they come, a point torn
+ *          by a power loss closes its block.
+ * @author  ael-mess
+ *
+ * @addtogroup MAIN
+ * @{
+ */
+
+#include "stdio.h"
+#include "string.h"
+
+#include "app_series.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define HEADER_MAGIC 0x5354 /* "TS" */
+#define HEADER_SIZE  12     /* magic, first value, sequence number, first minute */
+#define ENTRY_MAX    4      /* minute delta and a value delta of up to 17 bits */
+#define ERASED       0xFF
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static void put_u16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t* p, uint32_t v) {
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get_u16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+static uint32_t get_u32(const uint8_t* p) { return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16); }
+
+static uint32_t block_addr(uint32_t block) { return block * APP_SERIES_BLOCK_SIZE; }
+
+static uint32_t block_at(const app_series_t* s, uint32_t pos) { return (s->oldest + pos) % s->blocks; }
+
+static int flash_read(app_series_t* s, uint32_t addr, void* buf, size_t len) {
+    int ret = s->flash.read(s->flash.ctx, addr, buf, len);
+    s->stats.errors += (ret != 0);
+    return ret;
+}
+
+static int flash_write(app_series_t* s, uint32_t addr, const void* buf, size_t len) {
+    int ret = s->flash.write(s->flash.ctx, addr, buf, len);
+    s->stats.errors += (ret != 0);
+    s->stats.bytes += (ret == 0) ? len : 0;
+    return ret;
+}
+
+static bool header_decode(const uint8_t* h, uint32_t* seq, uint32_t* minute, uint16_t* value) {
+    if (get_u16(h) != HEADER_MAGIC) {
+        return false;
+    }
+    *value  = get_u16(h + 2);
+    *seq    = get_u32(h + 4);
+    *minute = get_u32(h + 8);
+    return true;
+}
+
+static size_t entry_encode(uint8_t* p, uint32_t delta, int32_t diff) {
+    uint32_t zz = ((uint32_t)diff << 1) ^ (uint32_t)(diff >> 31);
+    size_t   n  = 0;
+
+    p[n++] = (uint8_t)delta;
+    while (zz >= 0x80) {
+        p[n++] = (uint8_t)(zz | 0x80);
+        zz >>= 7;
+    }
+    p[n++] = (uint8_t)zz;
+    return n;
+}
+
+static size_t entry_decode(const uint8_t* p, size_t len, uint32_t* minute, uint16_t* value) {
+    // erased flash ends the block, so does a torn or invalid entry
+    if ((len < 2) || (p[0] == 0) || (p[0] > APP_SERIES_MAX_GAP)) {
+        return 0;
+    }
+
+    uint32_t zz = 0;
+    for (size_t i = 1; (i < len) && (i < ENTRY_MAX); i++) {
+        zz |= (uint32_t)(p[i] & 0x7F) << (7 * (i - 1));
+        if ((p[i] & 0x80) == 0) {
+            int32_t diff = (int32_t)(zz >> 1) ^ -(int32_t)(zz & 1);
+            *minute += p[0];
+            *value = (uint16_t)(*value + diff);
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+static size_t block_scan(app_series_t* s, size_t len, uint32_t* minute, uint16_t* value) {
+    size_t offset = HEADER_SIZE;
+    while (offset < len) {
+        size_t n = entry_decode(s->buf + offset, len - offset, minute, value);
+        if (n == 0) {
+            break;
+        }
+        offset += n;
+    }
+    return offset;
+}
+
+static bool block_valid(app_series_t* s, uint32_t block, uint32_t seq, uint32_t* minute) {
+    uint8_t  h[HEADER_SIZE];
+    uint32_t found;
+    uint16_t value;
+    return (flash_read(s, block_addr(block), h, sizeof(h)) == 0) && header_decode(h, &found, minute, &value) &&
+           (found == seq);
+}
+
+static bool block_erased(app_series_t* s, uint32_t block) {
+    uint8_t h[HEADER_SIZE];
+    if (flash_read(s, block_addr(block), h, sizeof(h)) != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(h); i++) {
+        if (h[i] != ERASED) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int block_open(app_series_t* s, uint32_t minute, uint16_t value) {
+    uint32_t per_sector = s->flash.sector_size / APP_SERIES_BLOCK_SIZE;
+    uint32_t block      = (s->count == 0) ? 0 : (block_at(s, s->count - 1) + 1) % s->blocks;
+
+    // blocks after the last one of a sector were erased with it, unless a header was torn: the rest of the sector
+    // stays unused, in the ring so that its blocks stay contiguous
+    if (((block % per_sector) != 0) && !block_erased(s, block)) {
+        for (; (block % per_sector) != 0; block = (block + 1) % s->blocks) {
+            s->first[block] = minute;
+            s->count++;
+        }
+    }
+
+    if ((block % per_sector) == 0) {
+        // the ring ends before the sector, the oldest blocks may lie in it
+        while ((s->count > 0) && ((s->oldest / per_sector) == (block / per_sector))) {
+            s->oldest = (s->oldest + 1) % s->blocks;
+            s->count--;
+        }
+        s->stats.erases++;
+        if (s->flash.erase(s->flash.ctx, block_addr(block)) != 0) {
+            s->stats.errors++;
+            return -1;
+        }
+    }
+
+    // the magic is written last, a header torn by a power loss is not taken for a block
+    uint8_t h[HEADER_SIZE];
+    put_u16(h, HEADER_MAGIC);
+    put_u16(h + 2, value);
+    put_u32(h + 4, s->seq + 1);
+    put_u32(h + 8, minute);
+    if ((flash_write(s, block_addr(block) + 2, h + 2, HEADER_SIZE - 2) != 0) ||
+        (flash_write(s, block_addr(block), h, 2) != 0)) {
+        return -1;
+    }
+
+    if (s->count == 0) {
+        s->oldest = block;
+    }
+    s->count++;
+    s->seq++;
+    s->first[block] = minute;
+    s->offset       = HEADER_SIZE;
+    return 0;
+}
+
+/**
+ * @brief   Initialize the store from flash.
+ * @note    The blocks are found back from their sequence numbers, the newest
+ *          one is scanned for its last point.
+ *
+ * @param[out] s        store pointer
+ * @param[in] flash     flash operations
+ * @return              0, -1 if the flash geometry is not supported or cannot be read
+ *
+ */
+int app_series_init(app_series_t* s, const app_series_flash_t* flash) {
+    memset(s, 0, sizeof(app_series_t));
+    s->flash  = *flash;
+    s->blocks = flash->size / APP_SERIES_BLOCK_SIZE;
+    s->blocks = (s->blocks > APP_SERIES_MAX_BLOCKS) ? APP_SERIES_MAX_BLOCKS : s->blocks;
+
+    uint32_t sector = flash->sector_size;
+    if ((sector < APP_SERIES_BLOCK_SIZE) || ((sector % APP_SERIES_BLOCK_SIZE) != 0) || (s->blocks == 0) ||
+        (((s->blocks * APP_SERIES_BLOCK_SIZE) % sector) != 0)) {
+        return -1;
+    }
+
+    // the newest block has the highest sequence number
+    bool     found  = false;
+    uint32_t newest = 0;
+    for (uint32_t b = 0; b < s->blocks; b++) {
+        uint8_t  h[HEADER_SIZE];
+        uint32_t seq, minute;
+        uint16_t value;
+        if (flash_read(s, block_addr(b), h, sizeof(h)) != 0) {
+            return -1;
+        }
+        if (header_decode(h, &seq, &minute, &value) && (!found || ((int32_t)(seq - s->seq) > 0))) {
+            found  = true;
+            newest = b;
+            s->seq = seq;
+        }
+    }
+    if (!found) {
+        return 0;
+    }
+
+    // older blocks precede it with consecutive sequence numbers
+    uint32_t per_sector = sector / APP_SERIES_BLOCK_SIZE;
+    uint32_t block      = newest;
+    uint32_t expected   = s->seq;
+    uint32_t next       = 0;
+    while (s->count < s->blocks) {
+        uint32_t minute;
+        uint32_t holes = 0;
+        bool     found = block_valid(s, block, expected, &minute);
+        // the end of a sector left unused after a torn header
+        while (!found && (s->count > 0) && ((block % per_sector) != 0) && ((s->count + holes + 1) < s->blocks)) {
+            holes++;
+            block--;
+            found = block_valid(s, block, expected, &minute);
+        }
+        if (!found) {
+            break;
+        }
+
+        for (uint32_t h = 1; h <= holes; h++) {
+            s->first[block + h] = next;
+        }
+        s->first[block] = minute;
+        s->oldest       = block;
+        s->count += holes + 1;
+        next  = minute;
+        block = (block + s->blocks - 1) % s->blocks;
+        expected--;
+    }
+
+    if (flash_read(s, block_addr(newest), s->buf, APP_SERIES_BLOCK_SIZE) != 0) {
+        return -1;
+    }
+    uint32_t seq;
+    header_decode(s->buf, &seq, &s->last_minute, &s->last_value);
+    s->offset = (uint32_t)block_scan(s, APP_SERIES_BLOCK_SIZE, &s->last_minute, &s->last_value);
+    if ((s->offset < APP_SERIES_BLOCK_SIZE) && (s->buf[s->offset] != ERASED)) {
+        // a torn point, the next one opens a block
+        s->offset = APP_SERIES_BLOCK_SIZE;
+    }
+    return 0;
+}
+
+/**
+ * @brief   Append a point.
+ *
+ * @param[in,out] s     store pointer
+ * @param[in] minute    point time, UTC minutes since the epoch
+ * @param[in] value     point value
+ * @return              0, -1 if the point is not later than the last one or on flash failure
+ *
+ */
+int app_series_append(app_series_t* s, uint32_t minute, uint16_t value) {
+    if ((s->count > 0) && (minute <= s->last_minute)) {
+        s->stats.rejected++;
+        return -1;
+    }
+
+    uint8_t entry[ENTRY_MAX];
+    size_t  n = 0;
+    if ((s->count > 0) && ((minute - s->last_minute) <= APP_SERIES_MAX_GAP)) {
+        n = entry_encode(entry, minute - s->last_minute, (int32_t)value - (int32_t)s->last_value);
+    }
+
+    if ((n == 0) || ((s->offset + n) > APP_SERIES_BLOCK_SIZE)) {
+        if (block_open(s, minute, value) != 0) {
+            return -1;
+        }
+    } else {
+        if (flash_write(s, block_addr(block_at(s, s->count - 1)) + s->offset, entry, n) != 0) {
+            return -1;
+        }
+        s->offset += (uint32_t)n;
+    }
+
+    s->last_minute = minute;
+    s->last_value  = value;
+    s->stats.points++;
+    return 0;
+}
+
+/**
+ * @brief   Read the points of a time range.
+ * @note    Points older than the retention are not returned. A range larger
+ *          than max points is read in steps, from the minute after the last
+ *          point returned.
+ *
+ * @param[in,out] s     store pointer
+ * @param[in] from      first minute
+ * @param[in] to        last minute, included
+ * @param[out] points   points in time order
+ * @param[in] max       points size
+ * @return              number of points
+ *
+ */
+size_t app_series_query(app_series_t* s, uint32_t from, uint32_t to, app_series_point_t* points, size_t max) {
+    s->stats.queries++;
+    if ((s->count == 0) || (max == 0)) {
+        return 0;
+    }
+
+    uint32_t retention = APP_SERIES_RETENTION_DAYS * 24 * 60;
+    if ((s->last_minute >= retention) && (from <= s->last_minute - retention)) {
+        from = s->last_minute - retention + 1;
+    }
+    if (from > to) {
+        return 0;
+    }
+
+    // last block starting at or before the range, the first one if none
+    uint32_t lo = 0, hi = s->count;
+    while ((hi - lo) > 1) {
+        uint32_t mid = (lo + hi) / 2;
+        if (s->first[block_at(s, mid)] <= from) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    size_t n = 0;
+    for (uint32_t pos = lo; (pos < s->count) && (n < max); pos++) {
+        uint32_t block = block_at(s, pos);
+        if (s->first[block] > to) {
+            break;
+        }
+
+        size_t len = (pos == (s->count - 1)) ? s->offset : APP_SERIES_BLOCK_SIZE;
+        uint32_t seq, minute;
+        uint16_t value;
+        if (flash_read(s, block_addr(block), s->buf, len) != 0) {
+            break;
+        }
+        s->stats.blocks_read++;
+        if (!header_decode(s->buf, &seq, &minute, &value)) {
+            // unused after a torn header
+            continue;
+        }
+
+        size_t offset = HEADER_SIZE;
+        while ((minute <= to) && (n < max)) {
+            if (minute >= from) {
+                points[n].minute = minute;
+                points[n].value  = value;
+                n++;
+            }
+            size_t step = entry_decode(s->buf + offset, len - offset, &minute, &value);
+            if (step == 0) {
+                break;
+            }
+            offset += step;
+        }
+        if (minute > to) {
+            break;
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief   Encode store statistics record.
+ *
+ * @param[in] s         store pointer
+ * @param[out] buf      output buffer
+ * @param[in] len       output buffer size
+ * @return              encoded length, 0 if the buffer is too small
+ *
+ */
+size_t app_series_encode(const app_series_t* s, char* buf, size_t len) {
+    uint32_t oldest = (s->count > 0) ? s->first[s->oldest] : 0;
+    int      n      = snprintf(buf, len,
+                     "{ \"type\": \"series\", \"blocks\": %u, \"capacity\": %u, \"oldest\": %llu, \"last\": %llu, "
+                     "\"points\": %u, \"rejected\": %u, \"bytes\": %u, \"erases\": %u, \"errors\": %u, "
+                     "\"queries\": %u, \"blocks_read\": %u }",
+                     (unsigned)s->count, (unsigned)s->blocks, oldest * 60ULL, s->last_minute * 60ULL,
+                     (unsigned)s->stats.points, (unsigned)s->stats.rejected, (unsigned)s->stats.bytes,
+                     (unsigned)s->stats.erases, (unsigned)s->stats.errors, (unsigned)s->stats.queries,
+                     (unsigned)s->stats.blocks_read);
+    return ((n > 0) && ((size_t)n < len)) ? (size_t)n : 0;
+}
+
+/** @} */
@@ -0,0 +1,65 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_slot.c
+ * @brief   Per device publish slots.
+ * @note    Pure C, no ESP-IDF dependency. Devices powered at the same time
+ *          would connect and publish in phase. Each device instead takes a
+ *          stable phase offset hashed from its MAC, so that consecutive MACs
+ *          of one batch spread evenly over the configured interval.
+ * @author  ael-mess
+ *
+ * @addtogroup MAIN
+ * @{
+ */
+
+#include "app_slot.h"
+
+/**
+ * @brief   Device phase offset.
+ *
+ * @param[in] mac       device MAC address
+ * @param[in] spread_ms offset interval
+ * @return              offset within [0, spread_ms), 0 if spread_ms is 0
+ *
+ */
+uint32_t app_slot_offset(const uint8_t mac[6], uint32_t spread_ms) {
+    if (spread_ms == 0) {
+        return 0;
+    }
+
+    // FNV-1a, then a murmur3 finalizer so that the last byte reaches every bit
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < 6; i++) {
+        h = (h ^ mac[i]) * 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+
+    return (uint32_t)(((uint64_t)h * spread_ms) >> 32);
+}
+
+/**
+ * @brief   Next slot of a device.
+ *
+ * @param[in] now_us    current time, monotonic clock
+ * @param[in] period_ms slot period
+ * @param[in] offset_ms device offset, reduced modulo the period
+ * @return              first time at or after now_us at offset_ms modulo period_ms, now_us if period_ms is 0
+ *
+ */
+int64_t app_slot_next(int64_t now_us, uint32_t period_ms, uint32_t offset_ms) {
+    if (period_ms == 0) {
+        return now_us;
+    }
+
+    int64_t period = (int64_t)period_ms * 1000;
+    int64_t offset = (int64_t)(offset_ms % period_ms) * 1000;
+    int64_t slot   = now_us - (now_us % period) + offset;
+    return (slot < now_us) ? slot + period : slot;
+}
+
+/** @} */
@@ -0,0 +1,64 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_sys.c
+ * @brief   System footprint report.
+ * @author  ael-mess
+ *
+ * @addtogroup IN
+ * @{
+ */
+
+#include "stdio.h"
+
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "app_sys.h"
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static const char* const m_tasks[] = {
+    APP_SYS_SAMPLE_TASK, APP_SYS_PUBLISH_TASK, APP_SYS_HTTP_TASK, APP_SYS_TOF_TASK, "mqtt_task", "tiT", "sys_evt",
+    "wifi", "esp_timer",
+};
+
+/**
+ * @brief   Encode memory footprint report.
+ * @note    Stack headroom is the task high-water mark in bytes, heap figures cover 8-bit capable memory.
+ *
+ * @param[out] buf  output buffer
+ * @param[in] len   output buffer size
+ * @return          encoded length, 0 if the buffer is too small
+ *
+ */
+size_t app_sys_footprint(char* buf, size_t len) {
+    int n = snprintf(buf, len,
+                     "{ \"type\": \"footprint\", \"uptime\": %lld, \"heap_free\": %u, \"heap_min\": %u, "
+                     "\"heap_largest\": %u, \"stacks\": {",
+                     esp_timer_get_time() / 1000000, heap_caps_get_free_size(MALLOC_CAP_8BIT),
+                     heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT), heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+
+    bool first = true;
+    for (size_t i = 0; (i < sizeof(m_tasks) / sizeof(m_tasks[0])) && (n > 0) && ((size_t)n < len); i++) {
+        TaskHandle_t task = xTaskGetHandle(m_tasks[i]);
+        if (task == NULL) {
+            continue;
+        }
+        n += snprintf(buf + n, len - n, "%s \"%s\": %u", first ? "" : ",", m_tasks[i],
+                      uxTaskGetStackHighWaterMark(task));
+        first = false;
+    }
+    if ((n > 0) && ((size_t)n < len)) {
+        n += snprintf(buf + n, len - n, " } }");
+    }
+
+    return ((n > 0) && ((size_t)n < len)) ? (size_t)n : 0;
+}
+
+/** @} */
@@ -0,0 +1,140 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_time.c
+ * @brief   SNTP time service.
+ * @author  ael-mess
+ *
+ * @addtogroup NET
+ * @{
+ */
+
+#include "stdbool.h"
+#include "sys/time.h"
+
+#include "sdkconfig.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_sntp.h"
+
+#include "freertos/FreeRTOS.h"
+
+#include "app_log.h"
+#if CONFIG_ENABLE_LOGGING
+static const char* TAG = "app-time";
+#endif
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define SNTP_SERVER CONFIG_SNTP_SERVER
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static portMUX_TYPE m_lock       = portMUX_INITIALIZER_UNLOCKED;
+static int64_t      m_offset_us  = 0; // UTC = monotonic + offset
+static bool         m_synced     = false;
+static bool         m_sync_event = false;
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static void on_time_sync(struct timeval* tv) {
+    int64_t utc_us = (int64_t)tv->tv_sec * 1000000LL + tv->tv_usec;
+    int64_t offset = utc_us - esp_timer_get_time();
+
+    portENTER_CRITICAL(&m_lock);
+    m_offset_us  = offset;
+    m_synced     = true;
+    m_sync_event = true;
+    portEXIT_CRITICAL(&m_lock);
+
+    RTN_LOGI(TAG, "Time synchronized, boot at %lld ms UTC", offset / 1000);
+}
+
+/**
+ * @brief   Start SNTP synchronization.
+ * @note    Called on each IP acquisition, only the first call starts the client.
+ *
+ */
+void app_time_start(void) {
+    if (sntp_enabled()) {
+        return;
+    }
+
+    RTN_LOGI(TAG, "Starting SNTP (%s)", SNTP_SERVER);
+    sntp_setoperatingmode(SNTP_OPMODE_POLL);
+    sntp_setservername(0, SNTP_SERVER);
+    sntp_set_sync_mode(SNTP_SYNC_MODE_IMMED);
+    sntp_set_time_sync_notification_cb(on_time_sync);
+    sntp_init();
+}
+
+/**
+ * @brief   Capture a sample timestamp.
+ *
+ * @return  monotonic time since boot in microseconds
+ *
+ */
+int64_t app_time_now(void) { return esp_timer_get_time(); }
+
+/**
+ * @brief   Synchronization state getter.
+ *
+ * @return  retrun synchronized
+ *
+ */
+bool app_time_is_synced(void) { return m_synced; }
+
+/**
+ * @brief   Convert a monotonic timestamp to UTC.
+ * @note    Samples captured before the first synchronization are corrected
+ *          as soon as the offset is known.
+ *
+ * @param[in] mono_us   monotonic timestamp (from app_time_now)
+ * @param[out] utc_ms   UTC time in milliseconds, or milliseconds since boot when not synchronized
+ * @return              retrun synchronized
+ *
+ */
+bool app_time_to_utc(int64_t mono_us, int64_t* utc_ms) {
+    portENTER_CRITICAL(&m_lock);
+    int64_t offset = m_offset_us;
+    bool    synced = m_synced;
+    portEXIT_CRITICAL(&m_lock);
+
+    *utc_ms = (mono_us + offset) / 1000;
+    return synced;
+}
+
+/**
+ * @brief   Consume a synchronization event.
+ * @note    Lets the uplink announce the boot time once, so that records already
+ *          sent unsynchronized can be corrected by the backend.
+ *
+ * @param[out] boot_utc_ms  UTC time of boot in milliseconds
+ * @return                  retrun true if a new synchronization happened
+ *
+ */
+bool app_time_take_sync(int64_t* boot_utc_ms) {
+    portENTER_CRITICAL(&m_lock);
+    bool event   = m_sync_event;
+    m_sync_event = false;
+    *boot_utc_ms = m_offset_us / 1000;
+    portEXIT_CRITICAL(&m_lock);
+
+    return event;
+}
+
+/**
+ * @brief   Raise the synchronization event again.
+ * @note    For a boot time announce that did not go out, the next app_time_take_sync() returns it again.
+ *
+ */
+void app_time_mark_sync(void) {
+    portENTER_CRITICAL(&m_lock);
+    m_sync_event = m_synced;
+    portEXIT_CRITICAL(&m_lock);
+}
+
+/** @} */
@@ -0,0 +1,212 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_tof.c
+ * @brief   Depth frame people segmentation.
+ * @note    Pure C, no ESP-IDF dependency, integer arithmetic only. The sensor
+ *          looks down from the ceiling, people are closer than the background.
+ *          Each frame runs one pass over the 64 contiguous zones (background
+ *          update and thresholding) and labels 8-connected blobs on a 64-bit
+ *          zone mask, a blob grows by word-wide dilations. Blobs holding more
+ *          than one head, people side by side, are split around their height
+ *          peaks.
+ * @author  ael-mess
+ *
+ * @addtogroup HW
+ * @{
+ */
+
+#include "stdlib.h"
+#include "string.h"
+
+#include "app_tof.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define COL_FIRST 0x0101010101010101ULL /* zones x = 0 */
+#define COL_LAST  0x8080808080808080ULL /* zones x = 7 */
+#define FG_SHIFT  (APP_TOF_BG_SHIFT + 4) /* a still foreground fades into the background 16 times slower */
+#define DEV_GAIN  2                      /* foreground above DEV_GAIN times the background noise */
+#define PEAK_DIST 3                      /* zones between two heads */
+#define MAX_PEAKS 4                      /* heads per blob */
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static uint64_t dilate(uint64_t b) {
+    uint64_t h = b | ((b << 1) & ~COL_FIRST) | ((b >> 1) & ~COL_LAST);
+    return h | (h << APP_TOF_SIZE) | (h >> APP_TOF_SIZE);
+}
+
+static int peak_dist(int a, int b) {
+    int dx = abs(a % APP_TOF_SIZE - b % APP_TOF_SIZE);
+    int dy = abs(a / APP_TOF_SIZE - b / APP_TOF_SIZE);
+    return (dx > dy) ? dx : dy;
+}
+
+static size_t blob_peaks(const app_tof_t* t, uint64_t mask, int* peaks) {
+    size_t count = 0;
+
+    // local maxima, highest first, at least PEAK_DIST apart
+    for (uint64_t m = mask; m != 0; m &= m - 1) {
+        int      i    = __builtin_ctzll(m);
+        uint16_t h    = t->height[i];
+        uint64_t near = dilate(1ULL << i) & mask & ~(1ULL << i);
+        bool     peak = true;
+        for (uint64_t n = near; (n != 0) && peak; n &= n - 1) {
+            int j = __builtin_ctzll(n);
+            peak  = (t->height[j] < h) || ((t->height[j] == h) && (j > i));
+        }
+        if (!peak) {
+            continue;
+        }
+
+        size_t k = count;
+        while ((k > 0) && (t->height[peaks[k - 1]] < h)) {
+            k--;
+        }
+        bool close = false;
+        for (size_t p = 0; (p < k) && !close; p++) {
+            close = (peak_dist(peaks[p], i) < PEAK_DIST);
+        }
+        if (close || (k >= MAX_PEAKS)) {
+            continue;
+        }
+        // a new higher peak removes the lower ones around it
+        int    kept[MAX_PEAKS];
+        size_t n = 0;
+        for (size_t p = 0; p < k; p++) {
+            kept[n++] = peaks[p];
+        }
+        kept[n++] = i;
+        for (size_t p = k; (p < count) && (n < MAX_PEAKS); p++) {
+            if (peak_dist(peaks[p], i) >= PEAK_DIST) {
+                kept[n++] = peaks[p];
+            }
+        }
+        memcpy(peaks, kept, n * sizeof(int));
+        count = n;
+    }
+    return count;
+}
+
+static void blob_stats(const app_tof_t* t, uint64_t mask, app_tof_blob_t* blob) {
+    uint32_t sum = 0, sum_x = 0, sum_y = 0, top = 0;
+
+    for (uint64_t m = mask; m != 0; m &= m - 1) {
+        int      i = __builtin_ctzll(m);
+        uint32_t h = t->height[i];
+        sum += h;
+        sum_x += h * (i % APP_TOF_SIZE);
+        sum_y += h * (i / APP_TOF_SIZE);
+        top = (h > top) ? h : top;
+    }
+
+    // zone centers are at half units
+    blob->mask      = mask;
+    blob->x_q8      = (uint16_t)(((sum_x << 8) + sum / 2) / sum + 128);
+    blob->y_q8      = (uint16_t)(((sum_y << 8) + sum / 2) / sum + 128);
+    blob->height_mm = (uint16_t)top;
+    blob->area      = (uint8_t)__builtin_popcountll(mask);
+}
+
+/**
+ * @brief   Initialize segmentation state.
+ *
+ * @param[out] t    segmentation state pointer
+ *
+ */
+void app_tof_init(app_tof_t* t) { memset(t, 0, sizeof(app_tof_t)); }
+
+/**
+ * @brief   Process a depth frame.
+ * @note    Zones closer than the background by the threshold plus the background
+ *          noise are foreground. The background follows slow changes: it is
+ *          updated with a 1/2^APP_TOF_BG_SHIFT gain, 16 times slower under the
+ *          foreground. No blob is reported while the background is learnt.
+ *
+ * @param[in,out] t     segmentation state pointer
+ * @param[in] depth     depth frame in mm, row major
+ * @param[out] blobs    detected blobs
+ * @param[in] max       blobs size
+ * @return              number of blobs
+ *
+ */
+size_t app_tof_process(app_tof_t* t, const uint16_t depth[APP_TOF_PIXELS], app_tof_blob_t* blobs, size_t max) {
+    bool     learning   = (t->frames < APP_TOF_LEARN_FRAMES);
+    int      shift      = learning ? 1 + (int)(t->frames / 4) : APP_TOF_BG_SHIFT;
+    uint64_t foreground = 0;
+
+    for (int i = 0; i < APP_TOF_PIXELS; i++) {
+        uint32_t d = depth[i];
+        t->height[i] = 0;
+        if ((d == 0) || (d >= APP_TOF_MAX_MM)) {
+            continue;
+        }
+
+        int32_t d_q4 = (int32_t)(d << 4);
+        if (t->bg[i] == 0) {
+            t->bg[i] = (uint16_t)d_q4;
+            continue;
+        }
+
+        int32_t diff = (int32_t)t->bg[i] - d_q4;
+        int32_t adev = (diff < 0) ? -diff : diff;
+        bool    fg   = !learning && (diff > ((APP_TOF_THRESHOLD_MM << 4) + DEV_GAIN * (int32_t)t->dev[i]));
+        if (fg) {
+            foreground |= 1ULL << i;
+            t->height[i] = (uint16_t)(diff >> 4);
+            t->bg[i]     = (uint16_t)(t->bg[i] - (diff >> FG_SHIFT));
+        } else {
+            t->bg[i]  = (uint16_t)(t->bg[i] - (diff >> shift));
+            t->dev[i] = (uint16_t)(t->dev[i] + ((adev - (int32_t)t->dev[i]) >> shift));
+        }
+    }
+    t->foreground = foreground;
+    t->frames++;
+
+    size_t count = 0;
+    while ((foreground != 0) && (count < max)) {
+        uint64_t blob = foreground & (~foreground + 1);
+        uint64_t prev;
+        do {
+            prev = blob;
+            blob = dilate(blob) & foreground;
+        } while (blob != prev);
+        foreground &= ~blob;
+
+        if (__builtin_popcountll(blob) < APP_TOF_MIN_AREA) {
+            continue;
+        }
+
+        int    peaks[MAX_PEAKS];
+        size_t n = blob_peaks(t, blob, peaks);
+        if (n < 2) {
+            blob_stats(t, blob, &blobs[count++]);
+            continue;
+        }
+
+        // grow every head by one ring at a time over the blob
+        uint64_t parts[MAX_PEAKS];
+        uint64_t claimed = 0;
+        for (size_t k = 0; k < n; k++) {
+            parts[k] = 1ULL << peaks[k];
+            claimed |= parts[k];
+        }
+        while (claimed != blob) {
+            uint64_t grown = claimed;
+            for (size_t k = 0; k < n; k++) {
+                parts[k] |= dilate(parts[k]) & blob & ~grown;
+                grown |= parts[k];
+            }
+            claimed = grown;
+        }
+        for (size_t k = 0; (k < n) && (count < max); k++) {
+            blob_stats(t, parts[k], &blobs[count++]);
+        }
+    }
+    return count;
+}
+
+/** @} */
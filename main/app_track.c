@@ -0,0 +1,235 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_track.c
+ * @brief   Multi-target people tracker.
+ * @note    Pure C, no ESP-IDF dependency, fixed memory. Each frame, tracks are
+ *          predicted at constant velocity, detections within the gate of a
+ *          prediction are assigned closest pair first, and matched tracks are
+ *          corrected by an alpha-beta filter. A confirmed track crossing the
+ *          line by more than the hysteresis on both sides raises one event,
+ *          so people lingering around the line are not counted twice. People
+ *          merged with someone else reappear as new tracks, their origin side
+ *          is then taken from their heading.
+ * @author  ael-mess
+ *
+ * @addtogroup HW
+ * @{
+ */
+
+#include "stdio.h"
+#include "string.h"
+
+#include "app_track.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define Q8(tenths) (((int32_t)(tenths) * 256) / 10)
+#define GATE       Q8(APP_TRACK_GATE)
+#define LINE       Q8(APP_TRACK_LINE)
+#define HYSTERESIS Q8(APP_TRACK_HYSTERESIS)
+#define EDGE       (-256) /* a track predicted one zone out of the frame ends */
+#define MAX_PAIRS  (APP_TRACK_MAX * APP_TOF_MAX_BLOBS)
+#define MIN_SPEED  16 /* zone units Q8 per frame, a walk at 60 Hz */
+
+typedef struct {
+    int32_t cost;
+    uint8_t track;
+    uint8_t blob;
+} pair_t;
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static int32_t clamp(int32_t v, int32_t limit) { return (v > limit) ? limit : (v < -limit) ? -limit : v; }
+
+static int8_t track_side(int32_t y) { return (y > LINE + HYSTERESIS) ? 1 : (y < LINE - HYSTERESIS) ? -1 : 0; }
+
+static size_t track_pairs(const app_track_t* t, const app_tof_blob_t* blobs, size_t count, pair_t* pairs) {
+    size_t n = 0;
+
+    for (size_t i = 0; i < APP_TRACK_MAX; i++) {
+        const app_track_obj_t* o = &t->tracks[i];
+        if (o->id == 0) {
+            continue;
+        }
+        for (size_t j = 0; j < count; j++) {
+            int32_t dx   = (int32_t)blobs[j].x_q8 - o->x;
+            int32_t dy   = (int32_t)blobs[j].y_q8 - o->y;
+            int32_t cost = dx * dx + dy * dy;
+            if (cost > GATE * GATE) {
+                continue;
+            }
+
+            // insertion sort, the pairs are few
+            size_t k = n++;
+            while ((k > 0) && (pairs[k - 1].cost > cost)) {
+                pairs[k] = pairs[k - 1];
+                k--;
+            }
+            pairs[k] = (pair_t){.cost = cost, .track = (uint8_t)i, .blob = (uint8_t)j};
+        }
+    }
+    return n;
+}
+
+static void track_correct(app_track_obj_t* o, const app_tof_blob_t* blob) {
+    int32_t rx = (int32_t)blob->x_q8 - o->x;
+    int32_t ry = (int32_t)blob->y_q8 - o->y;
+
+    // alpha 1/2, beta 1/4
+    o->x += rx / 2;
+    o->y += ry / 2;
+    o->vx     = clamp(o->vx + rx / 4, GATE);
+    o->vy     = clamp(o->vy + ry / 4, GATE);
+    o->hits   = (o->hits < UINT8_MAX) ? o->hits + 1 : UINT8_MAX;
+    o->misses = 0;
+}
+
+static bool track_cross(app_track_t* t, app_track_obj_t* o, app_track_event_t* event) {
+    // a track born within the band split off another, it comes from behind its heading
+    if ((o->side == 0) && (o->hits >= APP_TRACK_CONFIRM) && ((o->vy > MIN_SPEED) || (o->vy < -MIN_SPEED))) {
+        o->side = (o->vy > 0) ? -1 : 1;
+    }
+
+    int8_t side = track_side(o->y);
+    if ((side == 0) || (side == o->side)) {
+        return false;
+    }
+
+    // the side a track first shows up on is not a crossing
+    int8_t from = o->side;
+    o->side     = side;
+    if ((from == 0) || (o->hits < APP_TRACK_CONFIRM)) {
+        return false;
+    }
+
+    event->id  = o->id;
+    event->dir = (side > 0) ? APP_TRACK_IN : APP_TRACK_OUT;
+    if (side > 0) {
+        t->stats.in++;
+    } else {
+        t->stats.out++;
+    }
+    return true;
+}
+
+/**
+ * @brief   Initialize tracker.
+ *
+ * @param[out] t    tracker pointer
+ *
+ */
+void app_track_init(app_track_t* t) {
+    memset(t, 0, sizeof(app_track_t));
+    t->next_id = 1;
+}
+
+/**
+ * @brief   Update tracks with the detections of a frame.
+ * @note    Events beyond max are counted in the statistics but not returned.
+ *
+ * @param[in,out] t     tracker pointer
+ * @param[in] blobs     frame detections
+ * @param[in] count     number of detections
+ * @param[out] events   line crossing events
+ * @param[in] max       events size
+ * @return              number of events
+ *
+ */
+size_t app_track_update(app_track_t* t, const app_tof_blob_t* blobs, size_t count, app_track_event_t* events,
+                        size_t max) {
+    pair_t pairs[MAX_PAIRS];
+    bool   matched[APP_TRACK_MAX]  = {false};
+    bool   used[APP_TOF_MAX_BLOBS] = {false};
+    size_t n                       = 0;
+
+    count = (count < APP_TOF_MAX_BLOBS) ? count : APP_TOF_MAX_BLOBS;
+    t->stats.frames++;
+
+    for (size_t i = 0; i < APP_TRACK_MAX; i++) {
+        app_track_obj_t* o = &t->tracks[i];
+        if (o->id != 0) {
+            o->x += o->vx;
+            o->y += o->vy;
+        }
+    }
+
+    size_t npairs = track_pairs(t, blobs, count, pairs);
+    for (size_t k = 0; k < npairs; k++) {
+        const pair_t* p = &pairs[k];
+        if (matched[p->track] || used[p->blob]) {
+            continue;
+        }
+        matched[p->track] = true;
+        used[p->blob]     = true;
+
+        app_track_obj_t*  o = &t->tracks[p->track];
+        app_track_event_t event;
+        track_correct(o, &blobs[p->blob]);
+        if (track_cross(t, o, &event) && (n < max)) {
+            events[n++] = event;
+        }
+    }
+
+    for (size_t i = 0; i < APP_TRACK_MAX; i++) {
+        app_track_obj_t* o = &t->tracks[i];
+        if ((o->id == 0) || matched[i]) {
+            continue;
+        }
+        bool out = (o->x < EDGE) || (o->y < EDGE) || (o->x > APP_TOF_SIZE * 256 - EDGE) ||
+                   (o->y > APP_TOF_SIZE * 256 - EDGE);
+        if (out || (++o->misses > APP_TRACK_COAST)) {
+            o->id = 0;
+            t->stats.lost++;
+        }
+    }
+
+    for (size_t j = 0; j < count; j++) {
+        if (used[j]) {
+            continue;
+        }
+        size_t i = 0;
+        while ((i < APP_TRACK_MAX) && (t->tracks[i].id != 0)) {
+            i++;
+        }
+        if (i == APP_TRACK_MAX) {
+            t->stats.rejected++;
+            continue;
+        }
+
+        app_track_obj_t* o = &t->tracks[i];
+        memset(o, 0, sizeof(app_track_obj_t));
+        o->id   = t->next_id++;
+        o->x    = blobs[j].x_q8;
+        o->y    = blobs[j].y_q8;
+        o->hits = 1;
+        o->side = track_side(o->y);
+        if (t->next_id == 0) {
+            t->next_id = 1;
+        }
+        t->stats.born++;
+    }
+    return n;
+}
+
+/**
+ * @brief   Encode tracker statistics record.
+ *
+ * @param[in] stats     statistics pointer
+ * @param[out] buf      output buffer
+ * @param[in] len       output buffer size
+ * @return              encoded length, 0 if the buffer is too small
+ *
+ */
+size_t app_track_encode(const app_track_stats_t* stats, char* buf, size_t len) {
+    int n = snprintf(buf, len,
+                     "{ \"type\": \"tracker\", \"frames\": %u, \"born\": %u, \"lost\": %u, \"rejected\": %u, "
+                     "\"in\": %u, \"out\": %u }",
+                     (unsigned)stats->frames, (unsigned)stats->born, (unsigned)stats->lost,
+                     (unsigned)stats->rejected, (unsigned)stats->in, (unsigned)stats->out);
+    return ((n > 0) && ((size_t)n < len)) ? (size_t)n : 0;
+}
+
+/** @} */
@@ -0,0 +1,186 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_transport.c
+ * @brief   Uplink transport.
+ * @note    Encodes the uplink records and hands them to the transport selected
+ *          in Kconfig (CONFIG_TRANSPORT_MQTT, CONFIG_TRANSPORT_COAP or
+ *          CONFIG_TRANSPORT_RELAY).
+ * @author  ael-mess
+ *
+ * @addtogroup NET
+ * @{
+ */
+
+#include "stdio.h"
+#include "string.h"
+
+#include "esp_system.h"
+
+#include "app_transport.h"
+
+#include "app_payload.h"
+#include "app_time.h"
+
+#include "app_log.h"
+#if CONFIG_ENABLE_LOGGING
+static const char* TAG = "app-transport";
+#endif
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#if CONFIG_TRANSPORT_COAP
+#define TRANSPORT app_udp_transport
+#elif CONFIG_TRANSPORT_RELAY
+#define TRANSPORT app_leaf_transport
+#else
+#define TRANSPORT app_mqtt_transport
+#endif
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static char m_payload[64 + CONFIG_PUBLISH_MAX_BATCH * APP_PAYLOAD_RECORD_SIZE];
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+/**
+ * @brief   Start the uplink transport.
+ *
+ * @param[in] mac   device MAC address
+ * @return          retrun msg
+ *
+ */
+esp_err_t app_transport_start(uint8_t mac[6]) {
+    RTN_LOGI(TAG, "Uplink over %s", TRANSPORT.name);
+    return TRANSPORT.start(mac);
+}
+
+/**
+ * @brief   Process acknowledges and retransmissions.
+ * @note    Called periodically from the publishing task.
+ *
+ */
+void app_transport_poll(void) {
+    if (TRANSPORT.poll != NULL) {
+        TRANSPORT.poll();
+    }
+}
+
+/**
+ * @brief   Publish person counter.
+ * @note    A single record keeps the plain count format, several records are sent as one batch. A transport
+ *          taking the records unencoded gets them as they are.
+ *
+ * @param[in] records   counter records
+ * @param[in] count     number of records (max CONFIG_PUBLISH_MAX_BATCH)
+ * @return              retrun msg, ESP_ERR_TIMEOUT when the in-flight window is full
+ *
+ */
+esp_err_t app_transport_publish(const app_record_t* records, size_t count) {
+    count = (count < CONFIG_PUBLISH_MAX_BATCH) ? count : CONFIG_PUBLISH_MAX_BATCH;
+    if (TRANSPORT.send_records != NULL) {
+        return TRANSPORT.send_records(records, count);
+    }
+    if (app_payload_encode(m_payload, sizeof(m_payload), records, count, app_time_to_utc) == 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    return TRANSPORT.send(APP_TRANSPORT_COUNT, m_payload);
+}
+
+/**
+ * @brief   Publish time synchronization.
+ * @note    Unsynchronized records carry milliseconds since boot, adding boot time corrects them.
+ *          Records of this boot start at first_seq, lower numbers not received before are
+ *          not missing but were skipped by a power loss.
+ *
+ * @param[in] boot_utc_ms   UTC time of boot in milliseconds
+ * @param[in] first_seq     first record sequence number of this boot
+ * @return                  retrun msg
+ *
+ */
+esp_err_t app_transport_publish_sync(int64_t boot_utc_ms, uint32_t first_seq) {
+    char data[128] = {'\0'};
+    sprintf(data, "{ \"type\": \"sync\", \"boot\": %lld, \"seq\": %u }", boot_utc_ms, first_seq);
+
+    return TRANSPORT.send(APP_TRANSPORT_COUNT, data);
+}
+
+/**
+ * @brief   Publish analytics summary.
+ *
+ * @param[in] summary   closed interval summary
+ * @return              retrun msg
+ *
+ */
+esp_err_t app_transport_publish_summary(const app_analytics_summary_t* summary) {
+    int64_t ts;
+    app_time_to_utc(summary->start_us, &ts);
+
+    char data[384] = {'\0'};
+    if (app_analytics_encode(summary, ts, data, sizeof(data)) == 0) {
+        RTN_LOGE(TAG, "Summary record too large");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    return TRANSPORT.send(APP_TRANSPORT_COUNT, data);
+}
+
+/**
+ * @brief   Publish transport statistics.
+ *
+ * @return  retrun msg
+ *
+ */
+esp_err_t app_transport_publish_stats(void) {
+    char data[384] = {'\0'};
+    if (TRANSPORT.stats(data, sizeof(data)) == 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    return TRANSPORT.send(APP_TRANSPORT_TELEMETRY, data);
+}
+
+/**
+ * @brief   Publish device telemetry.
+ *
+ * @param[in] data  JSON telemetry message
+ * @return          retrun msg
+ *
+ */
+esp_err_t app_transport_publish_telemetry(const char* data) { return TRANSPORT.send(APP_TRANSPORT_TELEMETRY, data); }
+
+/**
+ * @brief   Publish a counter history chunk.
+ * @note    Delivered as counter records, within the in-flight window.
+ *
+ * @param[in] data  JSON history message
+ * @return          retrun msg, ESP_ERR_TIMEOUT if the window is full
+ *
+ */
+esp_err_t app_transport_publish_history(const char* data) { return TRANSPORT.send(APP_TRANSPORT_COUNT, data); }
+
+/**
+ * @brief   Publish counter records relayed for leaves.
+ * @note    Delivered as counter records, within the in-flight window. When
+ *          the transport tracks it, the delivery or the loss of the message
+ *          is reported with its token from the transport task.
+ *
+ * @param[in] data      JSON relay message
+ * @param[in] report    delivery report
+ * @param[out] token    token of the report, -1 if none follows
+ * @return              retrun msg, ESP_ERR_TIMEOUT if the window is full
+ *
+ */
+esp_err_t app_transport_publish_relay(const char* data, app_transport_report_t report, int* token) {
+    *token = -1;
+    if (TRANSPORT.send_tracked != NULL) {
+        return TRANSPORT.send_tracked(data, report, token);
+    }
+    return TRANSPORT.send(APP_TRANSPORT_COUNT, data);
+}
+
+/** @} */
@@ -0,0 +1,241 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_udp.c
+ * @brief   CoAP over UDP uplink.
+ * @note    Records are sent as non-confirmable CoAP POST requests, no connection
+ *          nor keepalive is kept. Counter records carry a token and are kept in a
+ *          bounded window until the receiver answers with a 2.04 response, they
+ *          are sent again with the same message id on timeout. Telemetry carries
+ *          the No-Response option and is never answered.
+ * @author  ael-mess
+ *
+ * @addtogroup NET
+ * @{
+ */
+
+#include "string.h"
+
+#include "esp_system.h"
+#include "esp_timer.h"
+
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+
+#include "freertos/FreeRTOS.h"
+
+#include "app_transport.h"
+#include "app_coap.h"
+
+#include "app_log.h"
+#if CONFIG_ENABLE_LOGGING
+static const char* TAG = "app-udp";
+#endif
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define COAP_HOST      CONFIG_COAP_SERVER_HOST
+#define COAP_PORT      CONFIG_COAP_SERVER_PORT
+#define COAP_PATH      CONFIG_COAP_SERVER_PATH
+#define COAP_WINDOW    CONFIG_COAP_WINDOW
+#define ACK_TIMEOUT    CONFIG_COAP_ACK_TIMEOUT
+#define MAX_RETRANSMIT CONFIG_COAP_MAX_RETRANSMIT
+#define DEVICE_ID      CONFIG_DEVICE_ID
+#define DATAGRAM_SIZE  1152 /* RFC 7252 message size upper bound, no IP fragmentation */
+
+typedef struct {
+    bool    used;
+    uint8_t tries;
+    uint8_t token[2];
+    int64_t sent_us;
+    size_t  len;
+    uint8_t datagram[DATAGRAM_SIZE];
+} pending_t;
+
+typedef struct {
+    uint32_t sent;        /* datagrams sent, retransmissions included */
+    uint32_t acked;       /* counter records answered by the receiver */
+    uint32_t retransmits; /* counter records sent again */
+    uint32_t lost;        /* counter records given up after CONFIG_COAP_MAX_RETRANSMIT */
+    uint32_t throttled;   /* publishes delayed by a full window */
+    uint32_t tx_bytes;    /* UDP payload bytes sent */
+    uint32_t rx_bytes;    /* UDP payload bytes received */
+} udp_stats_t;
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static int         m_sock = -1;
+static char        m_path[APP_COAP_PATH_MAX];
+static uint16_t    m_mid;
+static uint16_t    m_token;
+static pending_t   m_pending[COAP_WINDOW];
+static uint8_t     m_rx[128];
+static udp_stats_t m_stats;
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static void udp_transmit(const uint8_t* datagram, size_t len) {
+    if (send(m_sock, datagram, len, 0) == (ssize_t)len) {
+        m_stats.sent++;
+        m_stats.tx_bytes += len;
+    }
+}
+
+static void udp_receive(void) {
+    ssize_t len;
+    while ((len = recv(m_sock, m_rx, sizeof(m_rx), MSG_DONTWAIT)) > 0) {
+        m_stats.rx_bytes += len;
+
+        app_coap_msg_t msg;
+        if (!app_coap_decode(m_rx, len, &msg) || (msg.token_len != 2)) {
+            continue;
+        }
+        for (int i = 0; i < COAP_WINDOW; i++) {
+            if (m_pending[i].used && !memcmp(m_pending[i].token, msg.token, 2)) {
+                if (msg.code != APP_COAP_CHANGED) {
+                    RTN_LOGW(TAG, "Record rejected, code %u.%02u", msg.code >> 5, msg.code & 0x1f);
+                }
+                m_pending[i].used = false;
+                m_stats.acked++;
+                break;
+            }
+        }
+    }
+}
+
+static void udp_poll(void) {
+    if (m_sock < 0) {
+        return;
+    }
+    udp_receive();
+
+    // binary exponential back-off as for CoAP confirmable messages
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < COAP_WINDOW; i++) {
+        pending_t* p = &m_pending[i];
+        if (!p->used || ((now - p->sent_us) < ((int64_t)ACK_TIMEOUT * 1000 << (p->tries - 1)))) {
+            continue;
+        }
+        if (p->tries > MAX_RETRANSMIT) {
+            RTN_LOGW(TAG, "Record lost after %u attempts", p->tries);
+            p->used = false;
+            m_stats.lost++;
+            continue;
+        }
+        p->tries++;
+        p->sent_us = now;
+        m_stats.retransmits++;
+        udp_transmit(p->datagram, p->len);
+    }
+}
+
+static esp_err_t udp_send(app_transport_class_t msg_class, const char* data) {
+    if (m_sock < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    udp_poll();
+
+    app_coap_msg_t msg = {
+        .type        = APP_COAP_NON,
+        .code        = APP_COAP_POST,
+        .mid         = ++m_mid,
+        .format      = APP_COAP_JSON,
+        .no_response = (msg_class == APP_TRANSPORT_TELEMETRY),
+        .payload     = (const uint8_t*)data,
+        .payload_len = strlen(data),
+    };
+    strcpy(msg.path, m_path);
+
+    if (msg_class == APP_TRANSPORT_TELEMETRY) {
+        static uint8_t datagram[DATAGRAM_SIZE];
+        size_t         len = app_coap_encode(&msg, datagram, sizeof(datagram));
+        if (len == 0) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        udp_transmit(datagram, len);
+        return ESP_OK;
+    }
+
+    // backpressure: unanswered records are bounded by the window
+    pending_t* p = NULL;
+    for (int i = 0; (i < COAP_WINDOW) && (p == NULL); i++) {
+        p = m_pending[i].used ? NULL : &m_pending[i];
+    }
+    if (p == NULL) {
+        m_stats.throttled++;
+        RTN_LOGW(TAG, "Window full, publish delayed");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    m_token++;
+    msg.token_len = 2;
+    msg.token[0]  = (uint8_t)(m_token >> 8);
+    msg.token[1]  = (uint8_t)m_token;
+    p->len        = app_coap_encode(&msg, p->datagram, sizeof(p->datagram));
+    if (p->len == 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(p->token, msg.token, 2);
+    p->used    = true;
+    p->tries   = 1;
+    p->sent_us = esp_timer_get_time();
+    udp_transmit(p->datagram, p->len);
+    return ESP_OK;
+}
+
+static size_t udp_stats(char* buf, size_t len) {
+    uint32_t pending = 0;
+    for (int i = 0; i < COAP_WINDOW; i++) {
+        pending += m_pending[i].used;
+    }
+
+    int n = snprintf(buf, len,
+                     "{ \"type\": \"coap\", \"pending\": %u, \"sent\": %u, \"acked\": %u, \"retransmits\": %u, "
+                     "\"lost\": %u, \"throttled\": %u, \"tx_bytes\": %u, \"rx_bytes\": %u }",
+                     pending, m_stats.sent, m_stats.acked, m_stats.retransmits, m_stats.lost, m_stats.throttled,
+                     m_stats.tx_bytes, m_stats.rx_bytes);
+    return ((n > 0) && ((size_t)n < len)) ? (size_t)n : 0;
+}
+
+static esp_err_t udp_start(uint8_t mac[6]) {
+    RTN_LOGI(TAG, "Initializing coap uplink to %s:%d", COAP_HOST, COAP_PORT);
+    snprintf(m_path, sizeof(m_path), COAP_PATH, DEVICE_ID);
+
+    // random initial message id and token, a rebooted device is not taken for a duplicate
+    m_mid   = (uint16_t)esp_random();
+    m_token = (uint16_t)esp_random();
+
+    struct addrinfo  hints = {.ai_family = AF_INET, .ai_socktype = SOCK_DGRAM};
+    struct addrinfo* res   = NULL;
+    char             port[8];
+    sprintf(port, "%d", COAP_PORT);
+    if ((getaddrinfo(COAP_HOST, port, &hints, &res) != 0) || (res == NULL)) {
+        RTN_LOGE(TAG, "Cannot resolve %s", COAP_HOST);
+        return ESP_FAIL;
+    }
+
+    m_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if ((m_sock < 0) || (connect(m_sock, res->ai_addr, res->ai_addrlen) != 0)) {
+        RTN_LOGE(TAG, "Cannot open socket");
+        freeaddrinfo(res);
+        return ESP_FAIL;
+    }
+    freeaddrinfo(res);
+    return ESP_OK;
+}
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+const app_transport_t app_udp_transport = {
+    .name  = "coap",
+    .start = udp_start,
+    .send  = udp_send,
+    .poll  = udp_poll,
+    .stats = udp_stats,
+};
+
+/** @} */
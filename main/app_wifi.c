@@ -17,6 +17,7 @@
 #include "esp_wifi.h"
 
 #include "app_nvs.h"
+#include "app_time.h"
 
 #include "app_log.h"
 #if CONFIG_ENABLE_LOGGING
@@ -34,7 +35,9 @@ static const char* TAG = "app-wifi";
 /*===========================================================================*/
 /* Local variables.                                                          */
 /*===========================================================================*/
-static bool m_connected = false;
+static bool           m_connected = false;
+static bool           m_started   = false;
+static wifi_ps_type_t m_ps_mode   = WIFI_PS_NONE;
 
 /*===========================================================================*/
 /* Local functions.                                                          */
@@ -45,6 +48,7 @@ static void on_got_ip(void* arg, esp_event_base_t event_base, int32_t event_id,
     RTN_LOGI(TAG, "IPv4 address: " IPSTR, IP2STR(&event->ip_info.ip));
 #endif
     m_connected = true;
+    app_time_start();
 }
 
 #if CONFIG_ESP_WIFI_CONNECT_IPV6
@@ -193,7 +197,33 @@ esp_err_t app_wifi_open(char* wifi_ssid, char* wifi_pass, char* ap_ssid, char* a
     }
 
     ESP_ERROR_CHECK(esp_wifi_start());
-    ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_NONE));
+    ESP_ERROR_CHECK(esp_wifi_set_ps(m_ps_mode));
+    m_started = true;
+
+    return ESP_OK;
+}
+
+/**
+ * @brief   Initialize WiFi radio only.
+ * @note    The station does not associate, the radio stays on the given channel for ESP-NOW.
+ *
+ * @param[in] channel   WiFi channel, the one of the gateway AP
+ * @return              retrun msg
+ *
+ */
+esp_err_t app_wifi_open_radio(uint8_t channel) {
+    RTN_LOGI(TAG, "Initializing WiFi radio on channel %u ..", channel);
+
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+    ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_start());
+    ESP_ERROR_CHECK(esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE));
+    m_started = true;
 
     return ESP_OK;
 }
@@ -215,6 +245,19 @@ bool app_wifi_isconnected(void) { return m_connected; }
  */
 esp_err_t app_wifi_getmac(uint8_t mac[6]) { return esp_wifi_get_mac(WIFI_IF_STA, mac); }
 
+/**
+ * @brief   Set WiFi power save mode.
+ * @note    Applied immediately if WiFi is started, on start otherwise.
+ *
+ * @param[in] mode  power save mode (wifi_ps_type_t)
+ * @return          retrun msg
+ *
+ */
+esp_err_t app_wifi_set_ps(uint8_t mode) {
+    m_ps_mode = (wifi_ps_type_t)mode;
+    return m_started ? esp_wifi_set_ps(m_ps_mode) : ESP_OK;
+}
+
 /**
  * @brief   Close WiFi driver.
  *
@@ -234,6 +277,7 @@ void app_wifi_close(void) {
 
     RTN_LOGI(TAG, "Wi-Fi disconnected");
     m_connected = false;
+    m_started   = false;
 }
 
 /** @} */
@@ -2,3 +2,7 @@
 # "main" pseudo-component makefile.
 #
 # (Uses default behaviour of compiling all source files in directory, adding 'include' to include path.)
+
+ifdef CONFIG_BROKER_USE_TLS
+COMPONENT_EMBED_TXTFILES := certs/ca_bundle.pem
+endif
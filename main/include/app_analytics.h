@@ -0,0 +1,95 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_analytics.h
+ * @brief   Occupancy and dwell-time analytics.
+ * @author  ael-mess
+ *
+ * @addtogroup MAIN
+ * @{
+ */
+
+#ifndef _APP_ANALYTICS_H_
+#define _APP_ANALYTICS_H_
+
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+#ifdef CONFIG_ANALYTICS_INTERVAL
+#define APP_ANALYTICS_INTERVAL CONFIG_ANALYTICS_INTERVAL
+#else
+#define APP_ANALYTICS_INTERVAL 300
+#endif
+
+#ifdef CONFIG_ANALYTICS_BINS
+#define APP_ANALYTICS_BINS CONFIG_ANALYTICS_BINS
+#else
+#define APP_ANALYTICS_BINS 12
+#endif
+
+#ifdef CONFIG_ANALYTICS_DWELL_SLOTS
+#define APP_ANALYTICS_DWELL_SLOTS CONFIG_ANALYTICS_DWELL_SLOTS
+#else
+#define APP_ANALYTICS_DWELL_SLOTS 64
+#endif
+
+#define APP_ANALYTICS_DWELL_BINS 16 /* log2 seconds buckets */
+
+typedef struct {
+    int64_t  start_us;                     /* interval start, monotonic clock */
+    uint32_t duration_ms;                  /* interval duration */
+    uint16_t occupancy;                    /* occupancy at interval end */
+    uint16_t peak;                         /* occupancy peak */
+    uint32_t mean_x100;                    /* time-weighted mean occupancy x100 */
+    uint32_t entries;                      /* entries during interval */
+    uint32_t exits;                        /* exits during interval */
+    uint32_t dwell_s;                      /* mean dwell time (Little's law) */
+    uint32_t dwell_p50_s;                  /* dwell time median upper bound */
+    uint32_t dwell_p90_s;                  /* dwell time 90th percentile upper bound */
+    uint16_t entry_hist[APP_ANALYTICS_BINS]; /* entries per interval slice */
+    uint16_t exit_hist[APP_ANALYTICS_BINS];  /* exits per interval slice */
+} app_analytics_summary_t;
+
+typedef struct {
+    int64_t  interval_us;
+    int64_t  start_us;
+    int64_t  last_us;
+    uint64_t occ_us;    /* occupancy integral over the interval */
+    uint16_t occupancy; /* rolling occupancy */
+    uint16_t peak;
+    uint32_t entries;
+    uint32_t exits;
+    uint16_t entry_hist[APP_ANALYTICS_BINS];
+    uint16_t exit_hist[APP_ANALYTICS_BINS];
+    uint32_t dwell_hist[APP_ANALYTICS_DWELL_BINS];
+    int64_t  fifo[APP_ANALYTICS_DWELL_SLOTS]; /* entry times, oldest first */
+    uint16_t fifo_head;
+    uint16_t fifo_len;
+    bool     started;
+} app_analytics_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void   app_analytics_init(app_analytics_t* a, uint32_t interval_s);
+bool   app_analytics_update(app_analytics_t* a, uint16_t entries, uint16_t exits, int64_t now_us,
+                            app_analytics_summary_t* summary);
+bool   app_analytics_sample(app_analytics_t* a, uint16_t occupancy, int64_t now_us, app_analytics_summary_t* summary);
+size_t app_analytics_encode(const app_analytics_summary_t* summary, int64_t ts_ms, char* buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_ANALYTICS_H_ */
+
+/** @} */
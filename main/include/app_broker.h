@@ -0,0 +1,58 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_broker.h
+ * @brief   Ordered broker list with health tracking.
+ * @author  ael-mess
+ *
+ * @addtogroup NET
+ * @{
+ */
+
+#ifndef _APP_BROKER_H_
+#define _APP_BROKER_H_
+
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+#define APP_BROKER_MAX         4     /* primary and fallbacks */
+#define APP_BROKER_HOST_LEN    64
+#define APP_BROKER_BACKOFF_MS  1000  /* first retry of a failed broker */
+#define APP_BROKER_BACKOFF_MAX 64000 /* the retry delay doubles per failure up to this */
+
+typedef struct {
+    char     host[APP_BROKER_HOST_LEN];
+    uint16_t port;
+    bool     up;       /* connected at least once since the last failure */
+    uint32_t failures; /* consecutive failures, connection refused or lost */
+    uint32_t connects; /* successful connections */
+    uint32_t drops;    /* connections lost */
+    int64_t  retry_us; /* not selected before, monotonic clock */
+} app_broker_t;
+
+typedef struct {
+    app_broker_t brokers[APP_BROKER_MAX]; /* highest priority first */
+    size_t       count;
+} app_broker_list_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+size_t app_broker_init(app_broker_list_t* list, const char* host, uint16_t port, const char* fallbacks);
+void   app_broker_up(app_broker_list_t* list, int index);
+void   app_broker_down(app_broker_list_t* list, int index, int64_t now_us);
+int    app_broker_pick(const app_broker_list_t* list, int64_t now_us, int exclude);
+size_t app_broker_encode(const app_broker_list_t* list, int active, int standby, char* buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_BROKER_H_ */
+
+/** @} */
@@ -0,0 +1,66 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_coap.h
+ * @brief   CoAP message codec.
+ * @author  ael-mess
+ *
+ * @addtogroup NET
+ * @{
+ */
+
+#ifndef _APP_COAP_H_
+#define _APP_COAP_H_
+
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+#define APP_COAP_PORT      5683
+#define APP_COAP_PATH_MAX  64 /* Uri-Path, '/' separated */
+#define APP_COAP_TOKEN_MAX 8
+#define APP_COAP_JSON      50 /* application/json content format */
+#define APP_COAP_NO_FORMAT (-1)
+
+#define APP_COAP_CODE(c, d) ((uint8_t)(((c) << 5) | (d)))
+#define APP_COAP_POST       APP_COAP_CODE(0, 2)
+#define APP_COAP_CHANGED    APP_COAP_CODE(2, 4)
+#define APP_COAP_BAD_REQ    APP_COAP_CODE(4, 0)
+
+typedef enum {
+    APP_COAP_CON = 0, /* confirmable */
+    APP_COAP_NON,     /* non-confirmable */
+    APP_COAP_ACK,     /* acknowledgement */
+    APP_COAP_RST,     /* reset */
+} app_coap_type_t;
+
+typedef struct {
+    uint8_t        type;                       /* app_coap_type_t */
+    uint8_t        code;                       /* APP_COAP_CODE(class, detail) */
+    uint16_t       mid;                        /* message id, duplicate detection */
+    uint8_t        token_len;                  /* 0 to APP_COAP_TOKEN_MAX */
+    uint8_t        token[APP_COAP_TOKEN_MAX];  /* request and response matching */
+    char           path[APP_COAP_PATH_MAX];    /* Uri-Path, empty if none */
+    int16_t        format;                     /* Content-Format, APP_COAP_NO_FORMAT if none */
+    bool           no_response;                /* RFC 7967 No-Response, suppresses 2.xx responses */
+    const uint8_t* payload;                    /* payload, points into the decoded buffer */
+    size_t         payload_len;
+} app_coap_msg_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+size_t app_coap_encode(const app_coap_msg_t* msg, uint8_t* buf, size_t len);
+bool   app_coap_decode(const uint8_t* buf, size_t len, app_coap_msg_t* msg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_COAP_H_ */
+
+/** @} */
@@ -0,0 +1,46 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_config.h
+ * @brief   Runtime configuration.
+ * @author  ael-mess
+ *
+ * @addtogroup IN
+ * @{
+ */
+
+#ifndef _APP_CONFIG_H_
+#define _APP_CONFIG_H_
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+#define APP_CONFIG_SCHEMA 2 /* layout version of app_config_t and of command messages */
+
+typedef struct {
+    uint16_t schema;      /* APP_CONFIG_SCHEMA */
+    uint32_t version;     /* applied configuration version, increases on each change */
+    uint32_t publish_ms;  /* sampling period */
+    uint8_t  batch_size;  /* records per publish */
+    uint8_t  power_mode;  /* WiFi power save mode (wifi_ps_type_t) */
+    uint8_t  log_level;   /* application log level (esp_log_level_t) */
+    uint16_t deadband;    /* counter change published at once, 0 publishes every sample */
+    uint32_t min_ms;      /* minimum spacing between two publishes */
+    uint32_t heartbeat_s; /* publish interval without change */
+} app_config_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void      app_config_init(void);
+void      app_config_get(app_config_t* config);
+esp_err_t app_config_apply_json(const char* data, int length, const char** reason);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_CONFIG_H_ */
+
+/** @} */
@@ -0,0 +1,29 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_espnow.h
+ * @brief   ESP-NOW relay link.
+ * @author  ael-mess
+ *
+ * @addtogroup NET
+ * @{
+ */
+
+#ifndef _APP_ESPNOW_H_
+#define _APP_ESPNOW_H_
+
+#include "app_relay.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t app_espnow_init(app_relay_link_t* link);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_ESPNOW_H_ */
+
+/** @} */
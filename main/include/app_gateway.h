@@ -0,0 +1,31 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_gateway.h
+ * @brief   ESP-NOW gateway.
+ * @author  ael-mess
+ *
+ * @addtogroup NET
+ * @{
+ */
+
+#ifndef _APP_GATEWAY_H_
+#define _APP_GATEWAY_H_
+
+#include "stddef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t app_gateway_init(void);
+void      app_gateway_poll(void);
+size_t    app_gateway_stats(char* buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_GATEWAY_H_ */
+
+/** @} */
@@ -0,0 +1,34 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_history.h
+ * @brief   Counter history.
+ * @author  ael-mess
+ *
+ * @addtogroup MAIN
+ * @{
+ */
+
+#ifndef _APP_HISTORY_H_
+#define _APP_HISTORY_H_
+
+#include "stddef.h"
+#include "stdint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t app_history_init(void);
+void      app_history_sample(int64_t mono_us, uint16_t count);
+esp_err_t app_history_request(const char* data, int length);
+void      app_history_poll(void);
+size_t    app_history_stats(char* buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_HISTORY_H_ */
+
+/** @} */
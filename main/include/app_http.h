@@ -0,0 +1,54 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_http.h
+ * @brief   Local HTTP query API.
+ * @author  ael-mess
+ *
+ * @addtogroup NET
+ * @{
+ */
+
+#ifndef _APP_HTTP_H_
+#define _APP_HTTP_H_
+
+#include "stdbool.h"
+#include "stdint.h"
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+#ifdef CONFIG_HTTP_MAX_CLIENTS
+#define APP_HTTP_MAX_CLIENTS CONFIG_HTTP_MAX_CLIENTS
+#else
+#define APP_HTTP_MAX_CLIENTS 4
+#endif
+
+#ifdef CONFIG_HTTP_LONGPOLL_MS
+#define APP_HTTP_LONGPOLL_MS CONFIG_HTTP_LONGPOLL_MS
+#else
+#define APP_HTTP_LONGPOLL_MS 30000
+#endif
+
+typedef bool (*app_http_clock_t)(int64_t mono_us, int64_t* utc_ms);
+typedef int64_t (*app_http_now_t)(void);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int  app_http_init(uint16_t port, app_http_now_t now, app_http_clock_t clock);
+void app_http_poll(int timeout_ms);
+void app_http_notify(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_HTTP_H_ */
+
+/** @} */
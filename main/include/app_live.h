@@ -0,0 +1,48 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_live.h
+ * @brief   Live counter state and recent history.
+ * @author  ael-mess
+ *
+ * @addtogroup MAIN
+ * @{
+ */
+
+#ifndef _APP_LIVE_H_
+#define _APP_LIVE_H_
+
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+#include "app_record.h"
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+#ifdef CONFIG_HTTP_HISTORY_LEN
+#define APP_LIVE_HISTORY CONFIG_HTTP_HISTORY_LEN
+#else
+#define APP_LIVE_HISTORY 32
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool   app_live_push(const app_record_t* record);
+bool   app_live_current(app_record_t* record, uint32_t* seq);
+size_t app_live_history(app_record_t* records, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_LIVE_H_ */
+
+/** @} */
@@ -0,0 +1,65 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_loop.h
+ * @brief   Task loop period, jitter and stall monitor.
+ * @author  ael-mess
+ *
+ * @addtogroup MAIN
+ * @{
+ */
+
+#ifndef _APP_LOOP_H_
+#define _APP_LOOP_H_
+
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+#define APP_LOOP_BINS 5 /* jitter below 0.1, 1, 10, 100 ms and above */
+
+typedef struct {
+    uint32_t loops;
+    uint32_t periods;              /* periods measured against their expected length */
+    uint32_t period_min_us;
+    uint32_t period_max_us;
+    uint64_t period_sum_us;
+    uint32_t jitter[APP_LOOP_BINS]; /* period deviation histogram */
+    uint32_t late_max_us;           /* worst period overrun */
+    uint32_t busy_max_us;           /* worst time between wake and sleep */
+    uint32_t stalls;                /* loops late or busy beyond the threshold */
+} app_loop_stats_t;
+
+typedef struct {
+    const char*      name;
+    uint32_t         threshold_us; /* stall threshold */
+    int64_t          wake_us;      /* last wake time, 0 before the first loop */
+    uint32_t         expected_us;  /* expected period from the last wake, 0 if not periodic */
+    bool             stalled;      /* the current loop already counted as a stall */
+    uint32_t         last_late_us; /* overrun and busy time of the last stall */
+    uint32_t         last_busy_us;
+    uint32_t         stalls_total; /* stalls since start, never reset */
+    app_loop_stats_t stats;        /* statistics since the last report */
+} app_loop_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void   app_loop_init(app_loop_t* l, const char* name, uint32_t threshold_us);
+bool   app_loop_wake(app_loop_t* l, int64_t now_us, uint32_t expected_us);
+bool   app_loop_sleep(app_loop_t* l, int64_t now_us);
+size_t app_loop_encode(const app_loop_t* l, char* buf, size_t len);
+size_t app_loop_encode_stall(const app_loop_t* l, char* buf, size_t len);
+void   app_loop_reset(app_loop_t* l);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_LOOP_H_ */
+
+/** @} */
@@ -12,12 +12,31 @@
 #ifndef _APP_MQTT_H_
 #define _APP_MQTT_H_
 
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+typedef struct {
+    uint32_t inflight;       /* messages awaiting acknowledge */
+    int32_t  outbox;         /* esp-mqtt outbox size in bytes, -1 if unavailable */
+    uint32_t published;      /* messages handed to esp-mqtt */
+    uint32_t acked;          /* acknowledged messages */
+    uint32_t expired;        /* messages never acknowledged */
+    uint32_t retransmits;    /* messages sent again after a reconnection */
+    uint32_t reconnects;     /* broker reconnections */
+    uint32_t throttled;      /* publishes delayed by a full in-flight window */
+    uint32_t connect_ms;     /* last connection time, including TLS handshake */
+    uint32_t connect_max_ms; /* slowest connection time */
+    int32_t  broker;         /* broker index of the active session, 0 is the primary */
+    int32_t  standby;        /* broker index of the standby session, -1 if none */
+    uint32_t failovers;      /* sessions moved to another broker */
+    uint32_t handoffs;       /* in-flight messages published again on the new session */
+} app_mqtt_stats_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-esp_err_t app_mqtt_start(uint8_t mac[6]);
-void      app_mqtt_publish(uint8_t count);
+void app_mqtt_get_stats(app_mqtt_stats_t* stats);
 
 #ifdef __cplusplus
 }
@@ -27,6 +27,10 @@ esp_err_t app_nvs_set_wifi(char* ssid, char* pass);
 esp_err_t app_nvs_set_ap(char* ssid, char* pass);
 esp_err_t app_nvs_set_counter(uint16_t number);
 uint16_t  app_nvs_get_counter(void);
+esp_err_t app_nvs_set_config(const void* config, size_t length);
+esp_err_t app_nvs_get_config(void* config, size_t length);
+esp_err_t app_nvs_set_seq(uint32_t seq);
+uint32_t  app_nvs_get_seq(void);
 
 #ifdef __cplusplus
 }
@@ -21,6 +21,7 @@ void      app_ota_get_desc(char* version, char* name, char* time, char* date, ch
 esp_err_t app_ota_init(const char* ota_desc, const uint16_t length);
 esp_err_t app_ota_write(const char* ota_data, const uint16_t length);
 esp_err_t app_ota_update(void);
+void      app_ota_abort(void);
 
 #ifdef __cplusplus
 }
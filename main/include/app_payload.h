@@ -0,0 +1,40 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_payload.h
+ * @brief   Counter record encoding.
+ * @author  ael-mess
+ *
+ * @addtogroup NET
+ * @{
+ */
+
+#ifndef _APP_PAYLOAD_H_
+#define _APP_PAYLOAD_H_
+
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+#include "app_record.h"
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+#define APP_PAYLOAD_RECORD_SIZE 80 /* max encoded size of one batched record */
+
+typedef bool (*app_payload_utc_t)(int64_t mono_us, int64_t* utc_ms); /* false if the time is not synchronized */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+size_t app_payload_encode(char* buf, size_t len, const app_record_t* records, size_t count, app_payload_utc_t to_utc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_PAYLOAD_H_ */
+
+/** @} */
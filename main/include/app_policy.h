@@ -0,0 +1,66 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_policy.h
+ * @brief   Publish policy.
+ * @author  ael-mess
+ *
+ * @addtogroup MAIN
+ * @{
+ */
+
+#ifndef _APP_POLICY_H_
+#define _APP_POLICY_H_
+
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+typedef enum {
+    APP_POLICY_SUPPRESS = 0, /* nothing to report */
+    APP_POLICY_CHANGE,       /* the counter moved by at least the deadband */
+    APP_POLICY_HEARTBEAT,    /* no change for the heartbeat interval */
+} app_policy_decision_t;
+
+typedef struct {
+    uint16_t deadband;     /* counter change published, 0 publishes every sample */
+    uint32_t min_ms;       /* minimum spacing between two publishes */
+    uint32_t heartbeat_ms; /* maximum spacing between two publishes */
+} app_policy_config_t;
+
+typedef struct {
+    uint32_t samples;    /* checked samples */
+    uint32_t sent;       /* samples to publish */
+    uint32_t changes;    /* sent on change */
+    uint32_t heartbeats; /* sent on heartbeat */
+    uint32_t suppressed; /* samples not published */
+    uint32_t deferred;   /* changes held back by the minimum spacing */
+} app_policy_stats_t;
+
+typedef struct {
+    bool               started;
+    uint16_t           last_count; /* last published counter */
+    int64_t            last_us;    /* last publish time */
+    bool               pending;    /* a change awaits the minimum spacing */
+    app_policy_stats_t stats;
+} app_policy_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void                  app_policy_init(app_policy_t* p);
+app_policy_decision_t app_policy_check(app_policy_t* p, const app_policy_config_t* config, uint16_t count,
+                                       int64_t now_us);
+size_t                app_policy_encode(const app_policy_stats_t* stats, char* buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_POLICY_H_ */
+
+/** @} */
@@ -0,0 +1,28 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_record.h
+ * @brief   Counter record definition.
+ * @author  ael-mess
+ *
+ * @addtogroup MAIN
+ * @{
+ */
+
+#ifndef _APP_RECORD_H_
+#define _APP_RECORD_H_
+
+#include "stdint.h"
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+typedef struct {
+    uint32_t seq;     /* per device sequence number, never reused */
+    uint16_t count;   /* person counter */
+    int64_t  mono_us; /* capture time, monotonic clock */
+} app_record_t;
+
+#endif /* _APP_RECORD_H_ */
+
+/** @} */
@@ -0,0 +1,145 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_relay.h
+ * @brief   Counter record relay between leaves and a gateway.
+ * @author  ael-mess
+ *
+ * @addtogroup NET
+ * @{
+ */
+
+#ifndef _APP_RELAY_H_
+#define _APP_RELAY_H_
+
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+#include "app_payload.h"
+#include "app_record.h"
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+#define APP_RELAY_FRAME_SIZE    250 /* bytes, ESP-NOW payload limit */
+#define APP_RELAY_FRAME_RECORDS 24  /* records per data frame */
+#define APP_RELAY_QUEUE         64  /* records a leaf keeps until acknowledged */
+#define APP_RELAY_MAX_LEAVES    20  /* ESP-NOW unencrypted peers */
+#define APP_RELAY_MAX_BATCH     24  /* records per upstream message */
+#define APP_RELAY_RECORD_SIZE   112 /* max encoded size of one upstream record */
+#define APP_RELAY_RETRY_MAX     8   /* the retransmission delay doubles up to this many times the first one */
+#define APP_RELAY_PENDING       8   /* upstream messages awaiting their delivery report */
+
+typedef struct {
+    int (*send)(void* ctx, const uint8_t peer[6], const uint8_t* data, size_t len); /* 0 once queued */
+    int (*recv)(void* ctx, uint8_t peer[6], uint8_t* data, size_t len);             /* frame length, 0 if none */
+    void* ctx;
+} app_relay_link_t;
+
+/* 0 once the upstream took the message, its delivery is then reported with token, or not at all if -1 */
+typedef int (*app_relay_publish_t)(void* ctx, const char* data, int* token);
+
+typedef struct {
+    uint32_t frames;      /* data frames sent, retransmissions included */
+    uint32_t retransmits; /* data frames sent again on timeout */
+    uint32_t acked;       /* records acknowledged by the gateway */
+    uint32_t throttled;   /* pushes refused by a full queue */
+    uint32_t tx_bytes;    /* frame bytes sent */
+} app_relay_leaf_stats_t;
+
+typedef struct {
+    app_relay_link_t       link;
+    uint8_t                gateway[6];
+    uint32_t               retry_ms;   /* first retransmission delay */
+    app_record_t           queue[APP_RELAY_QUEUE];
+    size_t                 head;
+    size_t                 count;
+    size_t                 inflight;   /* queued records in the frame in flight, 0 if none */
+    uint32_t               backoff_ms; /* retransmission delay of the frame in flight */
+    int64_t                retry_us;   /* retransmission time of the frame in flight */
+    app_relay_leaf_stats_t stats;
+} app_relay_leaf_t;
+
+typedef struct {
+    uint8_t  mac[6];
+    bool     seen;       /* a record was accepted */
+    bool     acked;      /* a record was delivered upstream */
+    uint32_t last_seq;   /* last record accepted */
+    uint32_t acked_seq;  /* last record delivered upstream, acknowledged to the leaf */
+    uint32_t records;    /* records accepted */
+    uint32_t duplicates; /* records received again */
+} app_relay_peer_t;
+
+typedef struct {
+    uint8_t      peer;   /* index in the peer table */
+    app_record_t record; /* capture time on the gateway monotonic clock */
+} app_relay_entry_t;
+
+typedef struct {
+    int      token;                     /* delivery report token, -1 if not reported */
+    bool     reported;                  /* delivery known */
+    bool     delivered;                 /* reached the upstream */
+    int64_t  sent_us;                   /* publish time */
+    uint32_t peers;                     /* leaves with records in the message, one bit per peer */
+    uint32_t seq[APP_RELAY_MAX_LEAVES]; /* last record of each leaf in the message */
+} app_relay_pending_t;
+
+typedef struct {
+    uint32_t frames;     /* data frames received */
+    uint32_t records;    /* records accepted */
+    uint32_t duplicates; /* records received again */
+    uint32_t refused;    /* records not accepted, the batch is full or the peer table is */
+    uint32_t invalid;    /* malformed frames */
+    uint32_t messages;   /* upstream messages */
+    uint32_t deferred;   /* upstream publishes refused, sent again on the next poll */
+    uint32_t lost;       /* upstream messages taken but not delivered, the leaves send their records again */
+    uint32_t unreported; /* upstream messages without delivery report, counted lost */
+    uint32_t acks;       /* acknowledges sent */
+    uint32_t rx_bytes;   /* frame bytes received */
+} app_relay_gateway_stats_t;
+
+typedef struct {
+    app_relay_link_t          link;
+    app_relay_publish_t       publish;
+    void*                     publish_ctx;
+    app_payload_utc_t         to_utc;
+    uint32_t                  batch;     /* records per upstream message */
+    uint32_t                  delay_ms;  /* max time a record waits for a full batch */
+    uint32_t                  report_ms; /* max time a message waits for its delivery report */
+    app_relay_peer_t          peers[APP_RELAY_MAX_LEAVES];
+    size_t                    peers_count;
+    app_relay_entry_t         entries[APP_RELAY_MAX_BATCH];
+    size_t                    count;
+    int64_t                   first_us;  /* arrival of the oldest entry */
+    char                      buf[64 + APP_RELAY_MAX_BATCH * APP_RELAY_RECORD_SIZE];
+    app_relay_pending_t       pending[APP_RELAY_PENDING]; /* oldest first */
+    size_t                    pending_head;
+    size_t                    pending_count;
+    app_relay_gateway_stats_t stats;
+} app_relay_gateway_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void   app_relay_leaf_init(app_relay_leaf_t* leaf, const app_relay_link_t* link, const uint8_t gateway[6],
+                           uint32_t retry_ms);
+int    app_relay_leaf_push(app_relay_leaf_t* leaf, const app_record_t* records, size_t count);
+void   app_relay_leaf_poll(app_relay_leaf_t* leaf, int64_t now_us);
+size_t app_relay_leaf_encode(const app_relay_leaf_t* leaf, char* buf, size_t len);
+
+void   app_relay_gateway_init(app_relay_gateway_t* gw, const app_relay_link_t* link, app_relay_publish_t publish,
+                              void* publish_ctx, app_payload_utc_t to_utc, uint32_t batch, uint32_t delay_ms,
+                              uint32_t report_ms);
+void   app_relay_gateway_poll(app_relay_gateway_t* gw, int64_t now_us);
+void   app_relay_gateway_report(app_relay_gateway_t* gw, int token, bool delivered);
+size_t app_relay_gateway_encode(const app_relay_gateway_t* gw, char* buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_RELAY_H_ */
+
+/** @} */
@@ -0,0 +1,28 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_retain.h
+ * @brief   RTC memory counter retention.
+ * @author  ael-mess
+ *
+ * @addtogroup IN
+ * @{
+ */
+
+#ifndef _APP_RETAIN_H_
+#define _APP_RETAIN_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint16_t app_retain_restore(void);
+void     app_retain_store(uint16_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_RETAIN_H_ */
+
+/** @} */
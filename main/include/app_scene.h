@@ -0,0 +1,61 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_scene.h
+ * @brief   Synthetic depth frames of people walking under the sensor.
+ * @author  ael-mess
+ *
+ * @addtogroup HW
+ * @{
+ */
+
+#ifndef _APP_SCENE_H_
+#define _APP_SCENE_H_
+
+#include "stdbool.h"
+#include "stdint.h"
+
+#include "app_tof.h"
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+#define APP_SCENE_PEOPLE 6
+#define APP_SCENE_LINE   4.0f /* counting line, zone units along y */
+
+typedef struct {
+    bool  active;
+    float x, y;   /* zone units */
+    float vx, vy; /* zone units per frame */
+    float height_mm;
+    float radius; /* shoulders, zone units */
+    float turn_y; /* turns back there instead of crossing, 0 if it crosses */
+} app_scene_person_t;
+
+typedef struct {
+    uint32_t           seed;
+    uint32_t           rate_hz; /* frame rate */
+    uint32_t           frame;
+    bool               lanes; /* corridor, each direction on its half */
+    float              ceiling_mm;
+    app_scene_person_t people[APP_SCENE_PEOPLE];
+    uint32_t           in;        /* ground truth crossings, +y */
+    uint32_t           out;       /* ground truth crossings, -y */
+    uint8_t            frame_in;  /* crossings during the last frame, +y */
+    uint8_t            frame_out; /* crossings during the last frame, -y */
+} app_scene_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void app_scene_init(app_scene_t* s, uint32_t seed, uint32_t rate_hz);
+void app_scene_frame(app_scene_t* s, uint16_t depth[APP_TOF_PIXELS]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_SCENE_H_ */
+
+/** @} */
@@ -12,12 +12,17 @@
 #ifndef _APP_SENSOR_H_
 #define _APP_SENSOR_H_
 
+#include "stddef.h"
+#include "stdint.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 esp_err_t app_sensor_init(void);
-uint8_t   app_sensor_get_count(void);
+uint16_t  app_sensor_get_count(void);
+void      app_sensor_set_count(uint16_t count);
+size_t    app_sensor_stats(char* buf, size_t len);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,32 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_seq.h
+ * @brief   Record sequence numbers.
+ * @author  ael-mess
+ *
+ * @addtogroup IN
+ * @{
+ */
+
+#ifndef _APP_SEQ_H_
+#define _APP_SEQ_H_
+
+#include "stdbool.h"
+#include "stdint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t app_seq_init(void);
+bool     app_seq_ready(void);
+uint32_t app_seq_next(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_SEQ_H_ */
+
+/** @} */
@@ -0,0 +1,89 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_series.h
+ * @brief   Flash time-series store.
+ * @author  ael-mess
+ *
+ * @addtogroup MAIN
+ * @{
+ */
+
+#ifndef _APP_SERIES_H_
+#define _APP_SERIES_H_
+
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+#define APP_SERIES_BLOCK_SIZE 512 /* bytes, a flash sector holds a whole number of blocks */
+#define APP_SERIES_MAX_BLOCKS 512 /* index entries, a 256 KB partition */
+#define APP_SERIES_MAX_GAP    126 /* minutes between two points of a block, a longer gap opens a block */
+
+#ifdef CONFIG_HISTORY_RETENTION_DAYS
+#define APP_SERIES_RETENTION_DAYS CONFIG_HISTORY_RETENTION_DAYS
+#else
+#define APP_SERIES_RETENTION_DAYS 30
+#endif
+
+typedef struct {
+    uint32_t minute; /* UTC minutes since the epoch */
+    uint16_t value;
+} app_series_point_t;
+
+typedef struct {
+    int (*read)(void* ctx, uint32_t addr, void* buf, size_t len);
+    int (*write)(void* ctx, uint32_t addr, const void* buf, size_t len); /* NOR flash, only clears bits */
+    int (*erase)(void* ctx, uint32_t addr);                              /* erases the sector at addr */
+    void*    ctx;
+    uint32_t size;        /* bytes, a whole number of sectors */
+    uint32_t sector_size; /* bytes, a whole number of blocks */
+} app_series_flash_t;
+
+typedef struct {
+    uint32_t points;      /* appended points */
+    uint32_t rejected;    /* points not later than the last one */
+    uint32_t bytes;       /* bytes written */
+    uint32_t erases;      /* sectors erased */
+    uint32_t errors;      /* failed flash operations */
+    uint32_t queries;     /* range queries */
+    uint32_t blocks_read; /* blocks read by queries */
+} app_series_stats_t;
+
+typedef struct {
+    app_series_flash_t flash;
+    uint32_t           first[APP_SERIES_MAX_BLOCKS]; /* first minute of each block, by block number */
+    uint32_t           blocks;                       /* blocks of the partition */
+    uint32_t           oldest;                       /* block number of the oldest block */
+    uint32_t           count;                        /* blocks in use, the newest one is open */
+    uint32_t           seq;                          /* sequence number of the newest block */
+    uint32_t           offset;                       /* write offset in the newest block */
+    uint32_t           last_minute;                  /* last point */
+    uint16_t           last_value;
+    uint8_t            buf[APP_SERIES_BLOCK_SIZE];
+    app_series_stats_t stats;
+} app_series_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int    app_series_init(app_series_t* s, const app_series_flash_t* flash);
+int    app_series_append(app_series_t* s, uint32_t minute, uint16_t value);
+size_t app_series_query(app_series_t* s, uint32_t from, uint32_t to, app_series_point_t* points, size_t max);
+size_t app_series_encode(const app_series_t* s, char* buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_SERIES_H_ */
+
+/** @} */
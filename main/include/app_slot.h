@@ -0,0 +1,30 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_slot.h
+ * @brief   Per device publish slots.
+ * @author  ael-mess
+ *
+ * @addtogroup MAIN
+ * @{
+ */
+
+#ifndef _APP_SLOT_H_
+#define _APP_SLOT_H_
+
+#include "stdint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t app_slot_offset(const uint8_t mac[6], uint32_t spread_ms);
+int64_t  app_slot_next(int64_t now_us, uint32_t period_ms, uint32_t offset_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_SLOT_H_ */
+
+/** @} */
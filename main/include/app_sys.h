@@ -0,0 +1,35 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_sys.h
+ * @brief   System footprint report.
+ * @author  ael-mess
+ *
+ * @addtogroup IN
+ * @{
+ */
+
+#ifndef _APP_SYS_H_
+#define _APP_SYS_H_
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+#define APP_SYS_SAMPLE_TASK  "sample"
+#define APP_SYS_PUBLISH_TASK "publish"
+#define APP_SYS_HTTP_TASK    "http"
+#define APP_SYS_TOF_TASK     "tof"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+size_t app_sys_footprint(char* buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_SYS_H_ */
+
+/** @} */
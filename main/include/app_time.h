@@ -0,0 +1,32 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_time.h
+ * @brief   SNTP time service.
+ * @author  ael-mess
+ *
+ * @addtogroup NET
+ * @{
+ */
+
+#ifndef _APP_TIME_H_
+#define _APP_TIME_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void    app_time_start(void);
+int64_t app_time_now(void);
+bool    app_time_is_synced(void);
+bool    app_time_to_utc(int64_t mono_us, int64_t* utc_ms);
+bool    app_time_take_sync(int64_t* boot_utc_ms);
+void    app_time_mark_sync(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_TIME_H_ */
+
+/** @} */
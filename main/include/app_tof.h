@@ -0,0 +1,80 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_tof.h
+ * @brief   Depth frame people segmentation.
+ * @author  ael-mess
+ *
+ * @addtogroup HW
+ * @{
+ */
+
+#ifndef _APP_TOF_H_
+#define _APP_TOF_H_
+
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+#define APP_TOF_SIZE   8 /* zones per row and per column */
+#define APP_TOF_PIXELS (APP_TOF_SIZE * APP_TOF_SIZE)
+#define APP_TOF_MAX_MM 4000 /* depths of 0 or above are invalid zones */
+
+#ifdef CONFIG_TOF_THRESHOLD_MM
+#define APP_TOF_THRESHOLD_MM CONFIG_TOF_THRESHOLD_MM
+#else
+#define APP_TOF_THRESHOLD_MM 250
+#endif
+
+#ifdef CONFIG_TOF_BG_SHIFT
+#define APP_TOF_BG_SHIFT CONFIG_TOF_BG_SHIFT
+#else
+#define APP_TOF_BG_SHIFT 5
+#endif
+
+#ifdef CONFIG_TOF_MIN_AREA
+#define APP_TOF_MIN_AREA CONFIG_TOF_MIN_AREA
+#else
+#define APP_TOF_MIN_AREA 2
+#endif
+
+#define APP_TOF_MAX_BLOBS    8
+#define APP_TOF_LEARN_FRAMES 16 /* frames learning the background before detection */
+
+typedef struct {
+    uint64_t mask;      /* zones of the blob, bit y * APP_TOF_SIZE + x */
+    uint16_t x_q8;      /* height weighted centroid, zone units, Q8.8 */
+    uint16_t y_q8;
+    uint16_t height_mm; /* highest point above the background */
+    uint8_t  area;      /* zones */
+} app_tof_blob_t;
+
+typedef struct {
+    uint16_t bg[APP_TOF_PIXELS];     /* background depth, mm Q12.4 */
+    uint16_t dev[APP_TOF_PIXELS];    /* background mean absolute deviation, mm Q12.4 */
+    uint16_t height[APP_TOF_PIXELS]; /* height above the background of the last frame, mm */
+    uint64_t foreground;             /* foreground zones of the last frame */
+    uint32_t frames;
+} app_tof_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void   app_tof_init(app_tof_t* t);
+size_t app_tof_process(app_tof_t* t, const uint16_t depth[APP_TOF_PIXELS], app_tof_blob_t* blobs, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_TOF_H_ */
+
+/** @} */
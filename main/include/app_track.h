@@ -0,0 +1,101 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_track.h
+ * @brief   Multi-target people tracker.
+ * @author  ael-mess
+ *
+ * @addtogroup HW
+ * @{
+ */
+
+#ifndef _APP_TRACK_H_
+#define _APP_TRACK_H_
+
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+#include "app_tof.h"
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+#ifdef CONFIG_TRACK_MAX
+#define APP_TRACK_MAX CONFIG_TRACK_MAX
+#else
+#define APP_TRACK_MAX 8
+#endif
+
+/* distances in tenths of a zone */
+#ifdef CONFIG_TRACK_GATE
+#define APP_TRACK_GATE CONFIG_TRACK_GATE
+#else
+#define APP_TRACK_GATE 25
+#endif
+
+#ifdef CONFIG_TRACK_LINE
+#define APP_TRACK_LINE CONFIG_TRACK_LINE
+#else
+#define APP_TRACK_LINE 40
+#endif
+
+#ifdef CONFIG_TRACK_HYSTERESIS
+#define APP_TRACK_HYSTERESIS CONFIG_TRACK_HYSTERESIS
+#else
+#define APP_TRACK_HYSTERESIS 10
+#endif
+
+#define APP_TRACK_CONFIRM 2 /* frames matched before a track counts */
+#define APP_TRACK_COAST   5 /* frames a track is predicted without detection */
+
+typedef enum {
+    APP_TRACK_IN = 0, /* crossed the line towards +y */
+    APP_TRACK_OUT,    /* crossed the line towards -y */
+} app_track_dir_t;
+
+typedef struct {
+    uint16_t        id;
+    app_track_dir_t dir;
+} app_track_event_t;
+
+typedef struct {
+    uint16_t id;     /* 0 for a free slot */
+    int32_t  x, y;   /* position, zone units Q8 */
+    int32_t  vx, vy; /* velocity, zone units Q8 per frame */
+    uint8_t  hits;   /* matched frames, saturated */
+    uint8_t  misses; /* consecutive frames without detection */
+    int8_t   side;   /* side of the line last counted, -1, +1 or 0 until known */
+} app_track_obj_t;
+
+typedef struct {
+    uint32_t frames;
+    uint32_t born;     /* tracks started */
+    uint32_t lost;     /* tracks ended */
+    uint32_t rejected; /* detections without a free track */
+    uint32_t in;
+    uint32_t out;
+} app_track_stats_t;
+
+typedef struct {
+    app_track_obj_t   tracks[APP_TRACK_MAX];
+    uint16_t          next_id;
+    app_track_stats_t stats;
+} app_track_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void   app_track_init(app_track_t* t);
+size_t app_track_update(app_track_t* t, const app_tof_blob_t* blobs, size_t count, app_track_event_t* events,
+                        size_t max);
+size_t app_track_encode(const app_track_stats_t* stats, char* buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_TRACK_H_ */
+
+/** @} */
@@ -0,0 +1,64 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    app_transport.h
+ * @brief   Uplink transport.
+ * @author  ael-mess
+ *
+ * @addtogroup NET
+ * @{
+ */
+
+#ifndef _APP_TRANSPORT_H_
+#define _APP_TRANSPORT_H_
+
+#include "stdbool.h"
+
+#include "app_record.h"
+#include "app_analytics.h"
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+typedef enum {
+    APP_TRANSPORT_COUNT = 0, /* counter records, delivery is acknowledged */
+    APP_TRANSPORT_TELEMETRY, /* device telemetry, best effort */
+} app_transport_class_t;
+
+typedef void (*app_transport_report_t)(int token, bool delivered); /* from the transport task */
+
+typedef struct {
+    const char* name;
+    esp_err_t (*start)(uint8_t mac[6]);
+    esp_err_t (*send)(app_transport_class_t msg_class, const char* data); /* ESP_ERR_TIMEOUT if the window is full */
+    void (*poll)(void);                     /* acknowledges and retransmissions, may be NULL */
+    size_t (*stats)(char* buf, size_t len); /* JSON statistics record */
+    esp_err_t (*send_records)(const app_record_t* records, size_t count); /* records unencoded, may be NULL */
+    esp_err_t (*send_tracked)(const char* data, app_transport_report_t report, int* token); /* may be NULL */
+} app_transport_t;
+
+extern const app_transport_t app_mqtt_transport;
+extern const app_transport_t app_udp_transport;
+extern const app_transport_t app_leaf_transport;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t app_transport_start(uint8_t mac[6]);
+void      app_transport_poll(void);
+esp_err_t app_transport_publish(const app_record_t* records, size_t count);
+esp_err_t app_transport_publish_sync(int64_t boot_utc_ms, uint32_t first_seq);
+esp_err_t app_transport_publish_summary(const app_analytics_summary_t* summary);
+esp_err_t app_transport_publish_stats(void);
+esp_err_t app_transport_publish_telemetry(const char* data);
+esp_err_t app_transport_publish_history(const char* data);
+esp_err_t app_transport_publish_relay(const char* data, app_transport_report_t report, int* token);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_TRANSPORT_H_ */
+
+/** @} */
@@ -17,9 +17,11 @@ extern "C" {
 #endif
 
 esp_err_t app_wifi_open(char* wifi_ssid, char* wifi_pass, char* ap_ssid, char* ap_pass);
+esp_err_t app_wifi_open_radio(uint8_t channel);
 void      app_wifi_close(void);
 bool      app_wifi_isconnected(void);
 esp_err_t app_wifi_getmac(uint8_t mac[6]);
+esp_err_t app_wifi_set_ps(uint8_t mode);
 
 #ifdef __cplusplus
 }
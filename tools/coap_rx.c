@@ -0,0 +1,128 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    coap_rx.c
+ * @brief   Stand-in CoAP uplink receiver.
+ * @note    Receives the CoAP over UDP uplink (CONFIG_TRANSPORT_COAP), prints one
+ *          JSON line per record and answers counter records with 2.04 Changed:
+ *          ./tools/build/coap_rx [port] [loss_percent]
+ *          loss_percent drops datagrams on purpose to exercise retransmissions.
+ * @author  ael-mess
+ *
+ * @addtogroup TOOLS
+ * @{
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+
+#include "sys/socket.h"
+#include "netinet/in.h"
+#include "arpa/inet.h"
+
+#include "app_coap.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define RECENT_LEN 64 /* remembered message ids, duplicate detection */
+
+typedef struct {
+    uint32_t addr;
+    uint16_t port;
+    uint16_t mid;
+} recent_t;
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static recent_t m_recent[RECENT_LEN];
+static size_t   m_recent_head;
+static uint16_t m_mid;
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static int is_duplicate(const struct sockaddr_in* peer, uint16_t mid) {
+    for (size_t i = 0; i < RECENT_LEN; i++) {
+        if ((m_recent[i].addr == peer->sin_addr.s_addr) && (m_recent[i].port == peer->sin_port) &&
+            (m_recent[i].mid == mid)) {
+            return 1;
+        }
+    }
+
+    m_recent[m_recent_head].addr = peer->sin_addr.s_addr;
+    m_recent[m_recent_head].port = peer->sin_port;
+    m_recent[m_recent_head].mid  = mid;
+    m_recent_head                = (m_recent_head + 1) % RECENT_LEN;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    uint16_t port = (argc > 1) ? (uint16_t)atoi(argv[1]) : APP_COAP_PORT;
+    int      loss = (argc > 2) ? atoi(argv[2]) : 0;
+
+    int                sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = INADDR_ANY};
+    if ((sock < 0) || (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0)) {
+        perror("bind");
+        return 1;
+    }
+    fprintf(stderr, "Receiving CoAP on udp/%u, %d%% loss\n", port, loss);
+
+    srand((unsigned)time(NULL));
+    m_mid = (uint16_t)rand();
+
+    uint8_t  rx[1500];
+    uint8_t  tx[64];
+    uint64_t rx_bytes = 0;
+    uint64_t tx_bytes = 0;
+    while (1) {
+        struct sockaddr_in peer;
+        socklen_t          peer_len = sizeof(peer);
+        ssize_t            len      = recvfrom(sock, rx, sizeof(rx), 0, (struct sockaddr*)&peer, &peer_len);
+        if (len <= 0) {
+            continue;
+        }
+        if ((loss > 0) && ((rand() % 100) < loss)) {
+            continue;
+        }
+        rx_bytes += len;
+
+        app_coap_msg_t msg;
+        if (!app_coap_decode(rx, len, &msg) || (msg.code != APP_COAP_POST)) {
+            fprintf(stderr, "Malformed datagram from %s\n", inet_ntoa(peer.sin_addr));
+            continue;
+        }
+
+        int dup = is_duplicate(&peer, msg.mid);
+        printf("{\"from\":\"%s:%u\",\"path\":\"%s\",\"mid\":%u,\"dup\":%s,\"rx_bytes\":%llu,\"tx_bytes\":%llu,"
+               "\"record\":%.*s}\n",
+               inet_ntoa(peer.sin_addr), ntohs(peer.sin_port), msg.path, msg.mid, dup ? "true" : "false",
+               (unsigned long long)rx_bytes, (unsigned long long)tx_bytes, (int)msg.payload_len,
+               (const char*)msg.payload);
+        fflush(stdout);
+
+        // a retransmitted record is answered again, the previous answer may have been lost
+        if (!msg.no_response) {
+            app_coap_msg_t answer = {
+                .type      = APP_COAP_NON,
+                .code      = APP_COAP_CHANGED,
+                .mid       = ++m_mid,
+                .token_len = msg.token_len,
+                .format    = APP_COAP_NO_FORMAT,
+            };
+            memcpy(answer.token, msg.token, msg.token_len);
+
+            size_t n = app_coap_encode(&answer, tx, sizeof(tx));
+            if (sendto(sock, tx, n, 0, (struct sockaddr*)&peer, peer_len) == (ssize_t)n) {
+                tx_bytes += n;
+            }
+        }
+    }
+    return 0;
+}
+
+/** @} */
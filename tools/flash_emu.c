@@ -0,0 +1,140 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    flash_emu.c
+ * @brief   NOR flash emulator.
+ * @note    RAM backed, with the NOR constraints: a program only clears bits
+ *          and an erase sets a whole sector. The flash time is modelled from
+ *          the typical timings of a 4 MB SPI NOR (W25Q32) read at 40 MHz quad
+ *          I/O, as fitted on ESP32 modules. A power loss is simulated on the
+ *          write operation fail_after, only its first half lands.
+ * @author  ael-mess
+ *
+ * @addtogroup TOOLS
+ * @{
+ */
+
+#include "string.h"
+
+#include "flash_emu.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define READ_SETUP_US    1.0   /* command, address and dummy cycles */
+#define READ_BYTE_US     0.05  /* 4 bits per clock at 40 MHz */
+#define PROGRAM_FIRST_US 30.0  /* first byte of a page program */
+#define PROGRAM_BYTE_US  2.5   /* each additional byte */
+#define ERASE_US         45000 /* 4 KB sector erase */
+#define PAGE_SIZE        256   /* a program does not cross a page */
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+/**
+ * @brief   Initialize an erased flash.
+ *
+ * @param[out] f            emulator pointer
+ * @param[in] data          flash content, size bytes
+ * @param[in] size          flash size
+ * @param[in] sector_size   erase unit
+ *
+ */
+void flash_emu_init(flash_emu_t* f, uint8_t* data, uint32_t size, uint32_t sector_size) {
+    memset(f, 0, sizeof(flash_emu_t));
+    memset(data, 0xFF, size);
+    f->data        = data;
+    f->size        = size;
+    f->sector_size = sector_size;
+}
+
+/**
+ * @brief   Read flash.
+ *
+ * @param[in] ctx       emulator pointer
+ * @param[in] addr      flash address
+ * @param[out] buf      read data
+ * @param[in] len       bytes to read
+ * @return              0, -1 out of range or without power
+ *
+ */
+int flash_emu_read(void* ctx, uint32_t addr, void* buf, size_t len) {
+    flash_emu_t* f = ctx;
+    if (f->lost || ((addr + len) > f->size)) {
+        return -1;
+    }
+
+    memcpy(buf, f->data + addr, len);
+    f->stats.reads++;
+    f->stats.read_bytes += len;
+    f->stats.busy_us += READ_SETUP_US + READ_BYTE_US * len;
+    return 0;
+}
+
+/**
+ * @brief   Program flash.
+ *
+ * @param[in] ctx       emulator pointer
+ * @param[in] addr      flash address
+ * @param[in] buf       data to program
+ * @param[in] len       bytes to program
+ * @return              0, -1 out of range, setting a cleared bit or without power
+ *
+ */
+int flash_emu_write(void* ctx, uint32_t addr, const void* buf, size_t len) {
+    flash_emu_t*   f = ctx;
+    const uint8_t* p = buf;
+    if (f->lost || ((addr + len) > f->size)) {
+        return -1;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if ((f->data[addr + i] & p[i]) != p[i]) {
+            f->stats.violations++;
+            return -1;
+        }
+    }
+
+    // power lost mid-write, only the first half lands
+    if ((f->fail_after != 0) && (--f->fail_after == 0)) {
+        f->lost = true;
+        len /= 2;
+    }
+    for (size_t i = 0; i < len; i++) {
+        f->data[addr + i] &= p[i];
+    }
+    if (f->lost) {
+        return -1;
+    }
+
+    f->stats.writes++;
+    f->stats.write_bytes += len;
+    for (size_t done = 0; done < len;) {
+        size_t chunk = PAGE_SIZE - ((addr + done) % PAGE_SIZE);
+        chunk        = (chunk > (len - done)) ? len - done : chunk;
+        f->stats.busy_us += PROGRAM_FIRST_US + PROGRAM_BYTE_US * (chunk - 1);
+        done += chunk;
+    }
+    return 0;
+}
+
+/**
+ * @brief   Erase a flash sector.
+ *
+ * @param[in] ctx       emulator pointer
+ * @param[in] addr      sector address
+ * @return              0, -1 out of range, not aligned or without power
+ *
+ */
+int flash_emu_erase(void* ctx, uint32_t addr) {
+    flash_emu_t* f = ctx;
+    if (f->lost || ((addr % f->sector_size) != 0) || ((addr + f->sector_size) > f->size)) {
+        return -1;
+    }
+
+    memset(f->data + addr, 0xFF, f->sector_size);
+    f->stats.erases++;
+    f->stats.busy_us += ERASE_US * (f->sector_size / 4096.0);
+    return 0;
+}
+
+/** @} */
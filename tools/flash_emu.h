@@ -0,0 +1,56 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    flash_emu.h
+ * @brief   NOR flash emulator.
+ * @author  ael-mess
+ *
+ * @addtogroup TOOLS
+ * @{
+ */
+
+#ifndef _FLASH_EMU_H_
+#define _FLASH_EMU_H_
+
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+typedef struct {
+    uint64_t reads;      /* read operations */
+    uint64_t read_bytes;
+    uint64_t writes;     /* program operations */
+    uint64_t write_bytes;
+    uint64_t erases;     /* sector erases */
+    uint64_t violations; /* programs setting a cleared bit, refused */
+    double   busy_us;    /* modelled flash time */
+} flash_emu_stats_t;
+
+typedef struct {
+    uint8_t*          data;
+    uint32_t          size;
+    uint32_t          sector_size;
+    uint32_t          fail_after; /* the write operation torn by a simulated power loss, 0 for never */
+    bool              lost;       /* power lost, every operation fails until cleared */
+    flash_emu_stats_t stats;
+} flash_emu_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void flash_emu_init(flash_emu_t* f, uint8_t* data, uint32_t size, uint32_t sector_size);
+int  flash_emu_read(void* ctx, uint32_t addr, void* buf, size_t len);
+int  flash_emu_write(void* ctx, uint32_t addr, const void* buf, size_t len);
+int  flash_emu_erase(void* ctx, uint32_t addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FLASH_EMU_H_ */
+
+/** @} */
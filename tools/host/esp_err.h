@@ -0,0 +1,22 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    esp_err.h
+ * @brief   Host stand-in of the ESP-IDF error codes used by the application modules.
+ * @author  ael-mess
+ *
+ * @addtogroup TOOLS
+ * @{
+ */
+
+#ifndef _HOST_ESP_ERR_H_
+#define _HOST_ESP_ERR_H_
+
+typedef int esp_err_t;
+
+#define ESP_OK   0
+#define ESP_FAIL -1
+
+#endif /* _HOST_ESP_ERR_H_ */
+
+/** @} */
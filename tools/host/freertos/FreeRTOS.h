@@ -0,0 +1,23 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    FreeRTOS.h
+ * @brief   Host stand-in of the FreeRTOS critical sections, single threaded.
+ * @author  ael-mess
+ *
+ * @addtogroup TOOLS
+ * @{
+ */
+
+#ifndef _HOST_FREERTOS_H_
+#define _HOST_FREERTOS_H_
+
+typedef int portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux)      ((void)(mux))
+#define portEXIT_CRITICAL(mux)       ((void)(mux))
+
+#endif /* _HOST_FREERTOS_H_ */
+
+/** @} */
@@ -0,0 +1,12 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    task.h
+ * @brief   Host stand-in of the FreeRTOS tasks, none is created.
+ * @author  ael-mess
+ *
+ * @addtogroup TOOLS
+ * @{
+ */
+
+/** @} */
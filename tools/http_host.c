@@ -0,0 +1,55 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    http_host.c
+ * @brief   Local HTTP API on the host.
+ * @note    Serves the HTTP API from a simulated counter changing every 2 s:
+ *          ./tools/build/http_host [port], then curl http://127.0.0.1:<port>/events
+ * @author  ael-mess
+ *
+ * @addtogroup TOOLS
+ * @{
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "time.h"
+
+#include "app_http.h"
+#include "app_live.h"
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static int64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int main(int argc, char** argv) {
+    uint16_t port = (argc > 1) ? (uint16_t)atoi(argv[1]) : 8080;
+    if (app_http_init(port, now_us, NULL) != 0) {
+        perror("app_http_init");
+        return 1;
+    }
+    printf("Serving on http://127.0.0.1:%u (/count, /count?since=<seq>, /history, /events)\n", port);
+
+    uint16_t count   = 0;
+    int64_t  next_us = now_us();
+    while (1) {
+        if (now_us() >= next_us) {
+            next_us += 2000000;
+            count = (uint16_t)(count + (rand() % 3) + (count ? -1 : 0));
+
+            app_record_t record = {.count = count, .mono_us = now_us()};
+            if (app_live_push(&record)) {
+                app_http_notify();
+            }
+        }
+        app_http_poll(100);
+    }
+    return 0;
+}
+
+/** @} */
@@ -0,0 +1,144 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    link_udp.c
+ * @brief   Relay frame link over local UDP.
+ * @note    Host stand-in of the ESP-NOW link (app_relay_link_t): each node is
+ *          a UDP socket on 127.0.0.1, its address is the locally administered
+ *          MAC 02:00:7f:00 followed by its port. Frames are datagrams, a given
+ *          share of them is dropped on purpose to exercise retransmissions.
+ * @author  ael-mess
+ *
+ * @addtogroup TOOLS
+ * @{
+ */
+
+#include "stdlib.h"
+#include "string.h"
+#include "unistd.h"
+
+#include "fcntl.h"
+#include "sys/socket.h"
+#include "netinet/in.h"
+#include "arpa/inet.h"
+
+#include "link_udp.h"
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static void to_addr(const uint8_t mac[6], struct sockaddr_in* addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family      = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr->sin_port        = htons((uint16_t)((mac[4] << 8) | mac[5]));
+}
+
+/**
+ * @brief   Open a node.
+ *
+ * @param[out] l    link state
+ * @param[in] port  local UDP port, the node address
+ * @param[in] loss  percent of the frames sent that are dropped
+ * @return          0 on success, -1 otherwise
+ *
+ */
+int link_udp_open(link_udp_t* l, uint16_t port, uint32_t loss) {
+    memset(l, 0, sizeof(*l));
+    l->port = port;
+    l->loss = loss;
+    l->sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (l->sock < 0) {
+        return -1;
+    }
+
+    uint8_t            mac[6];
+    struct sockaddr_in addr;
+    link_udp_mac(port, mac);
+    to_addr(mac, &addr);
+    if ((bind(l->sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) ||
+        (fcntl(l->sock, F_SETFL, fcntl(l->sock, F_GETFL) | O_NONBLOCK) != 0)) {
+        close(l->sock);
+        l->sock = -1;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief   Close a node.
+ *
+ * @param[in,out] l link state
+ *
+ */
+void link_udp_close(link_udp_t* l) {
+    if (l->sock >= 0) {
+        close(l->sock);
+        l->sock = -1;
+    }
+}
+
+/**
+ * @brief   Node address of a port.
+ *
+ * @param[in] port  UDP port
+ * @param[out] mac  node address
+ *
+ */
+void link_udp_mac(uint16_t port, uint8_t mac[6]) {
+    const uint8_t prefix[4] = {0x02, 0x00, 0x7f, 0x00};
+    memcpy(mac, prefix, sizeof(prefix));
+    mac[4] = (uint8_t)(port >> 8);
+    mac[5] = (uint8_t)port;
+}
+
+/**
+ * @brief   Send a frame, app_relay_link_t operation.
+ *
+ * @param[in] ctx   link state
+ * @param[in] peer  destination address
+ * @param[in] data  frame
+ * @param[in] len   frame length
+ * @return          0 once sent or dropped on purpose, -1 on error
+ *
+ */
+int link_udp_send(void* ctx, const uint8_t peer[6], const uint8_t* data, size_t len) {
+    link_udp_t*        l = ctx;
+    struct sockaddr_in addr;
+
+    l->stats.sent++;
+    l->stats.tx_bytes += len;
+    if ((l->loss > 0) && ((uint32_t)(rand() % 100) < l->loss)) {
+        l->stats.dropped++;
+        return 0;
+    }
+
+    to_addr(peer, &addr);
+    return (sendto(l->sock, data, len, 0, (struct sockaddr*)&addr, sizeof(addr)) == (ssize_t)len) ? 0 : -1;
+}
+
+/**
+ * @brief   Receive a frame without waiting, app_relay_link_t operation.
+ *
+ * @param[in] ctx   link state
+ * @param[out] peer source address
+ * @param[out] data frame
+ * @param[in] len   frame buffer size
+ * @return          frame length, 0 if none
+ *
+ */
+int link_udp_recv(void* ctx, uint8_t peer[6], uint8_t* data, size_t len) {
+    link_udp_t*        l = ctx;
+    struct sockaddr_in addr;
+    socklen_t          addr_len = sizeof(addr);
+
+    ssize_t n = recvfrom(l->sock, data, len, 0, (struct sockaddr*)&addr, &addr_len);
+    if (n <= 0) {
+        return 0;
+    }
+    link_udp_mac(ntohs(addr.sin_port), peer);
+    l->stats.received++;
+    return (int)n;
+}
+
+/** @} */
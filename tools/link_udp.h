@@ -0,0 +1,51 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    link_udp.h
+ * @brief   Relay frame link over local UDP.
+ * @author  ael-mess
+ *
+ * @addtogroup TOOLS
+ * @{
+ */
+
+#ifndef _LINK_UDP_H_
+#define _LINK_UDP_H_
+
+#include "stddef.h"
+#include "stdint.h"
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+typedef struct {
+    uint64_t sent;     /* frames sent */
+    uint64_t dropped;  /* frames dropped on purpose */
+    uint64_t received; /* frames received */
+    uint64_t tx_bytes; /* frame bytes sent, dropped ones included */
+} link_udp_stats_t;
+
+typedef struct {
+    int              sock;
+    uint16_t         port;
+    uint32_t         loss; /* percent of the frames sent that are dropped */
+    link_udp_stats_t stats;
+} link_udp_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int  link_udp_open(link_udp_t* l, uint16_t port, uint32_t loss);
+void link_udp_close(link_udp_t* l);
+void link_udp_mac(uint16_t port, uint8_t mac[6]);
+int  link_udp_send(void* ctx, const uint8_t peer[6], const uint8_t* data, size_t len);
+int  link_udp_recv(void* ctx, uint8_t peer[6], uint8_t* data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LINK_UDP_H_ */
+
+/** @} */
@@ -0,0 +1,296 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    relay_sim.c
+ * @brief   Leaves relaying their records through one gateway, over local UDP.
+ * @note    Each leaf and the gateway run app_relay over their own UDP socket
+ *          (link_udp, the stand-in of ESP-NOW), on a simulated clock stepped
+ *          every 10 ms. Leaves produce records at a given rate, a share of the
+ *          frames is dropped both ways, and midway the upstream refuses the
+ *          gateway messages for a while, the messages in flight when it goes
+ *          down are lost. Deliveries are reported after a broker round trip,
+ *          a share of the reports can be dropped (a full report queue on
+ *          target). Every record must reach the upstream, once unless reports
+ *          are dropped; the cost on air, the batching and the delivery delay
+ *          are reported:
+ *          ./tools/build/relay_sim [leaves] [records_per_s] [seconds] [loss_percent] [outage_s] [seed]
+ *          [drop_reports_percent]
+ * @author  ael-mess
+ *
+ * @addtogroup TOOLS
+ * @{
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+
+#include "app_relay.h"
+#include "link_udp.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define STEP_US   10000
+#define BASE_PORT 47000          /* gateway, leaves follow */
+#define EPOCH_MS  1666180800000LL
+#define RETRY_MS  1500           /* CONFIG_RELAY_RETRY_MS */
+#define BATCH     20             /* CONFIG_RELAY_BATCH */
+#define DELAY_MS  1000           /* CONFIG_RELAY_MAX_DELAY_MS */
+#define BACKLOG   1024           /* records a leaf keeps before the relay queue, publishing task and queue */
+#define DRAIN_S   600            /* time given to the last records */
+#define BROKER_MS 200            /* upstream message to its delivery report */
+#define REPORT_MS 60000          /* 2 * CONFIG_MQTT_INFLIGHT_EXPIRE */
+
+typedef struct {
+    bool    used;
+    int64_t due_us; /* delivery, or loss if the upstream is down then */
+    char    data[sizeof(((app_relay_gateway_t*)0)->buf)];
+} upstream_t;
+
+typedef struct {
+    link_udp_t       link;
+    app_relay_leaf_t relay;
+    double           due;     /* records to produce */
+    uint32_t         next;    /* next sequence number */
+    app_record_t     backlog[BACKLOG];
+    size_t           head;
+    size_t           count;
+    uint32_t         overflow; /* records lost before the relay */
+    uint8_t*         seen;     /* upstream deliveries per sequence number */
+} leaf_t;
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static leaf_t*             m_leaves;
+static uint32_t            m_leaf_count;
+static link_udp_t          m_gw_link;
+static app_relay_gateway_t m_gw;
+static int64_t             m_now_us;
+static int64_t             m_outage_from_us;
+static int64_t             m_outage_to_us;
+static uint32_t            m_capacity; /* sequence numbers tracked per leaf */
+static uint64_t            m_delivered;
+static uint64_t            m_duplicates;
+static uint32_t*           m_latency_ms;
+static uint64_t            m_latency_count;
+static upstream_t          m_upstream[APP_RELAY_PENDING]; /* messages in flight, the token is the index */
+static uint32_t            m_lost;
+static uint32_t            m_drop;    /* share of the delivery reports dropped, percent */
+static uint32_t            m_dropped; /* delivery reports dropped */
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static bool to_utc(int64_t mono_us, int64_t* utc_ms) {
+    *utc_ms = EPOCH_MS + mono_us / 1000;
+    return true;
+}
+
+static bool upstream_down(int64_t now_us) { return (now_us >= m_outage_from_us) && (now_us < m_outage_to_us); }
+
+static int publish(void* ctx, const char* data, int* token) {
+    (void)ctx;
+    if (upstream_down(m_now_us)) {
+        return -1;
+    }
+    for (int i = 0; i < APP_RELAY_PENDING; i++) {
+        if (!m_upstream[i].used) {
+            m_upstream[i].used   = true;
+            m_upstream[i].due_us = m_now_us + BROKER_MS * 1000;
+            snprintf(m_upstream[i].data, sizeof(m_upstream[i].data), "%s", data);
+            *token = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static void deliver(const char* data) {
+    // { "leaf": "02007f00b7d9", "seq": 12, "value": 3, "ts": 1666180800991, "sync": true }
+    const char* p = data;
+    while ((p = strstr(p, "\"leaf\": \"")) != NULL) {
+        unsigned  port;
+        unsigned  seq;
+        long long ts;
+        if (sscanf(p, "\"leaf\": \"02007f00%4x\", \"seq\": %u, \"value\": %*u, \"ts\": %lld", &port, &seq, &ts) != 3) {
+            fprintf(stderr, "Bad upstream record: %.80s\n", p);
+            exit(1);
+        }
+        p++;
+
+        leaf_t* leaf = &m_leaves[port - BASE_PORT - 1];
+        if (leaf->seen[seq]++) {
+            m_duplicates++;
+            continue;
+        }
+        m_delivered++;
+        m_latency_ms[m_latency_count++] = (uint32_t)(EPOCH_MS + m_now_us / 1000 - ts);
+    }
+}
+
+static void upstream_poll(void) {
+    for (int i = 0; i < APP_RELAY_PENDING; i++) {
+        upstream_t* u = &m_upstream[i];
+        if (!u->used || (m_now_us < u->due_us)) {
+            continue;
+        }
+        bool delivered = !upstream_down(u->due_us);
+        if (delivered) {
+            deliver(u->data);
+        } else {
+            m_lost++;
+        }
+        u->used = false;
+        if ((m_drop > 0) && ((uint32_t)(rand() % 100) < m_drop)) {
+            m_dropped++;
+            continue;
+        }
+        app_relay_gateway_report(&m_gw, i, delivered);
+    }
+}
+
+static void produce(leaf_t* leaf, double rate) {
+    for (leaf->due += rate * STEP_US / 1e6; leaf->due >= 1; leaf->due--) {
+        if ((leaf->count == BACKLOG) || (leaf->next == m_capacity)) {
+            leaf->overflow++;
+            continue;
+        }
+        app_record_t* r = &leaf->backlog[(leaf->head + leaf->count++) % BACKLOG];
+        r->seq          = leaf->next++;
+        r->count        = (uint16_t)(rand() % 40);
+        r->mono_us      = m_now_us;
+    }
+}
+
+static void push(leaf_t* leaf) {
+    // like the publishing task, in batches, kept while the relay queue is full
+    while (leaf->count > 0) {
+        size_t n = (leaf->count < 8) ? leaf->count : 8;
+        n        = (leaf->head + n > BACKLOG) ? BACKLOG - leaf->head : n;
+        if (app_relay_leaf_push(&leaf->relay, &leaf->backlog[leaf->head], n) != 0) {
+            break;
+        }
+        leaf->head = (leaf->head + n) % BACKLOG;
+        leaf->count -= n;
+    }
+}
+
+static int cmp_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char** argv) {
+    m_leaf_count     = (argc > 1) ? (uint32_t)atoi(argv[1]) : 20;
+    double   rate    = (argc > 2) ? atof(argv[2]) : 1.0;
+    uint32_t seconds = (argc > 3) ? (uint32_t)atoi(argv[3]) : 300;
+    uint32_t loss    = (argc > 4) ? (uint32_t)atoi(argv[4]) : 10;
+    uint32_t outage  = (argc > 5) ? (uint32_t)atoi(argv[5]) : 30;
+    unsigned seed    = (argc > 6) ? (unsigned)atoi(argv[6]) : 1;
+    m_drop           = (argc > 7) ? (uint32_t)atoi(argv[7]) : 0;
+    srand(seed);
+
+    if ((m_leaf_count == 0) || (m_leaf_count > APP_RELAY_MAX_LEAVES)) {
+        fprintf(stderr, "1 to %d leaves\n", APP_RELAY_MAX_LEAVES);
+        return 1;
+    }
+    m_capacity       = (uint32_t)(rate * seconds) + 2;
+    m_leaves         = calloc(m_leaf_count, sizeof(leaf_t));
+    m_latency_ms     = malloc(sizeof(uint32_t) * m_capacity * m_leaf_count);
+    m_outage_from_us = (int64_t)seconds / 2 * 1000000;
+    m_outage_to_us   = m_outage_from_us + (int64_t)outage * 1000000;
+
+    uint8_t          gw_mac[6];
+    app_relay_link_t link = {.send = link_udp_send, .recv = link_udp_recv};
+    link_udp_mac(BASE_PORT, gw_mac);
+    if (link_udp_open(&m_gw_link, BASE_PORT, loss) != 0) {
+        fprintf(stderr, "Cannot open UDP port %d\n", BASE_PORT);
+        return 1;
+    }
+    link.ctx = &m_gw_link;
+    app_relay_gateway_init(&m_gw, &link, publish, NULL, to_utc, BATCH, DELAY_MS, REPORT_MS);
+
+    for (uint32_t i = 0; i < m_leaf_count; i++) {
+        leaf_t* leaf = &m_leaves[i];
+        leaf->seen   = calloc(m_capacity, 1);
+        if (link_udp_open(&leaf->link, (uint16_t)(BASE_PORT + 1 + i), loss) != 0) {
+            fprintf(stderr, "Cannot open UDP port %u\n", BASE_PORT + 1 + i);
+            return 1;
+        }
+        link.ctx = &leaf->link;
+        app_relay_leaf_init(&leaf->relay, &link, gw_mac, RETRY_MS);
+    }
+
+    // records are produced for the given time, then the last ones drain
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t produced = 0;
+    int64_t  end_us   = (int64_t)seconds * 1000000;
+    for (m_now_us = 0; m_now_us < end_us + DRAIN_S * 1000000LL; m_now_us += STEP_US) {
+        bool pending = false;
+        for (uint32_t i = 0; i < m_leaf_count; i++) {
+            leaf_t* leaf = &m_leaves[i];
+            if (m_now_us < end_us) {
+                produce(leaf, rate);
+            }
+            push(leaf);
+            app_relay_leaf_poll(&leaf->relay, m_now_us);
+            pending |= (leaf->count > 0) || (leaf->relay.count > 0);
+        }
+        upstream_poll();
+        app_relay_gateway_poll(&m_gw, m_now_us);
+        if ((m_now_us >= end_us) && !pending && (m_gw.count == 0) && (m_gw.pending_count == 0)) {
+            break;
+        }
+    }
+    struct timespec stop;
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    double wall_s = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+
+    uint64_t overflow = 0;
+    uint64_t frames   = 0;
+    uint64_t retries  = 0;
+    uint64_t air      = m_gw_link.stats.tx_bytes;
+    for (uint32_t i = 0; i < m_leaf_count; i++) {
+        produced += m_leaves[i].next;
+        overflow += m_leaves[i].overflow;
+        frames += m_leaves[i].relay.stats.frames;
+        retries += m_leaves[i].relay.stats.retransmits;
+        air += m_leaves[i].link.stats.tx_bytes;
+    }
+
+    printf("{\"leaves\":%u,\"rate\":%.2f,\"seconds\":%u,\"loss\":%u,\"outage_s\":%u,\"produced\":%llu,"
+           "\"delivered\":%llu,\"missing\":%llu,\"duplicates\":%llu,\"overflow\":%llu}\n",
+           m_leaf_count, rate, seconds, loss, outage, (unsigned long long)produced, (unsigned long long)m_delivered,
+           (unsigned long long)(produced - m_delivered), (unsigned long long)m_duplicates,
+           (unsigned long long)overflow);
+    printf("{\"frames\":%llu,\"retransmits\":%llu,\"acks\":%u,\"frames_per_record\":%.3f,\"air_bytes_per_record\":%.1f,"
+           "\"messages\":%u,\"records_per_message\":%.1f,\"deferred\":%u,\"lost\":%u,\"reports_dropped\":%u,"
+           "\"unreported\":%u}\n",
+           (unsigned long long)frames, (unsigned long long)retries, m_gw.stats.acks,
+           (double)(frames + m_gw.stats.acks) / m_delivered, (double)air / m_delivered, m_gw.stats.messages,
+           (double)m_delivered / m_gw.stats.messages, m_gw.stats.deferred, m_lost, m_dropped,
+           m_gw.stats.unreported);
+
+    qsort(m_latency_ms, m_latency_count, sizeof(uint32_t), cmp_u32);
+    printf("{\"latency_ms_p50\":%u,\"latency_ms_p99\":%u,\"latency_ms_max\":%u,\"wall_s\":%.2f,"
+           "\"records_per_wall_s\":%.0f}\n",
+           m_latency_ms[m_latency_count / 2], m_latency_ms[m_latency_count * 99 / 100],
+           m_latency_ms[m_latency_count - 1], wall_s, m_delivered / wall_s);
+
+    for (uint32_t i = 0; i < m_leaf_count; i++) {
+        link_udp_close(&m_leaves[i].link);
+        free(m_leaves[i].seen);
+    }
+    link_udp_close(&m_gw_link);
+    free(m_latency_ms);
+    free(m_leaves);
+    // a dropped report is taken as a lost message, its records may be delivered twice
+    return ((produced == m_delivered) && ((m_duplicates == 0) || (m_dropped > 0))) ? 0 : 1;
+}
+
+/** @} */
@@ -0,0 +1,47 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    sensor_check.c
+ * @brief   Counter restore checks of the sensor driver, with dummy data.
+ * @note    A counter restored after a reset must be read back as it was, any
+ *          value of the record counter included, then counting goes on:
+ *          ./tools/build/sensor_check
+ * @author  ael-mess
+ *
+ * @addtogroup TOOLS
+ * @{
+ */
+
+#include "stdbool.h"
+#include "stdio.h"
+
+#include "esp_err.h"
+
+#include "app_sensor.h"
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static int check_restore(uint16_t count) {
+    app_sensor_set_count(count);
+    uint16_t first  = app_sensor_get_count();
+    uint16_t second = app_sensor_get_count();
+    bool     ok     = (first == count) && (second == (uint16_t)(count + 1));
+
+    printf("{\"restored\":%u,\"first\":%u,\"second\":%u,\"ok\":%s}\n", count, first, second, ok ? "true" : "false");
+    return ok ? 0 : 1;
+}
+
+int main(void) {
+    int failed = 0;
+
+    app_sensor_init();
+    failed += (app_sensor_get_count() != 0);
+    failed += check_restore(7);
+    failed += check_restore(300);
+    failed += check_restore(UINT16_MAX);
+
+    return failed ? 1 : 0;
+}
+
+/** @} */
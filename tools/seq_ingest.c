@@ -0,0 +1,209 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    seq_ingest.c
+ * @brief   Record deduplication and gap detection at ingest.
+ * @note    Reads uplink messages on stdin, one per line, either as printed by
+ *          mosquitto_sub -v (topic and payload) or by coap_rx, and prints one
+ *          JSON line per record with its status. Only "new" and "late" records
+ *          are to be stored. Records relayed by a gateway are numbered by
+ *          their leaf, they are checked per gateway and leaf ("device/leaf").
+ *          Missing ranges are printed when a gap opens, and the per device
+ *          statistics at end of input:
+ *          mosquitto_sub -v -t 'iot/dev/+/data' | ./tools/build/seq_ingest
+ * @author  ael-mess
+ *
+ * @addtogroup TOOLS
+ * @{
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#include "seq_window.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define MAX_DEVICES 256 /* power of 2 */
+#define DEVICE_LEN  64
+#define LINE_LEN    4096
+#define MAX_RANGES  8
+#define LEAF_LEN    12 /* MAC address in hex */
+#define MAX_TOUCHED 64 /* devices with a record in one message */
+
+typedef struct {
+    char         name[DEVICE_LEN + 1 + LEAF_LEN];
+    seq_window_t window;
+    bool         gap; /* a gap opened in the current message */
+} device_t;
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static device_t m_devices[MAX_DEVICES];
+
+static const char* const m_status[] = {
+    [SEQ_NEW]       = "new",
+    [SEQ_LATE]      = "late",
+    [SEQ_DUPLICATE] = "duplicate",
+    [SEQ_STALE]     = "stale",
+};
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static device_t* device_get(const char* name) {
+    // FNV-1a hash, open addressing
+    uint32_t hash = 2166136261u;
+    for (const char* c = name; *c != '\0'; c++) {
+        hash = (hash ^ (uint8_t)*c) * 16777619u;
+    }
+
+    for (uint32_t i = 0; i < MAX_DEVICES; i++) {
+        device_t* d = &m_devices[(hash + i) & (MAX_DEVICES - 1)];
+        if (d->name[0] == '\0') {
+            snprintf(d->name, sizeof(d->name), "%s", name);
+            seq_window_init(&d->window);
+            return d;
+        }
+        if (!strcmp(d->name, name)) {
+            return d;
+        }
+    }
+    return NULL;
+}
+
+static void device_name(const char* line, char* name) {
+    const char* start = line;
+    size_t      len   = strcspn(line, " \t");
+
+    // coap_rx output: device from the resource path
+    const char* path = strstr(line, "\"path\":\"");
+    if ((line[0] == '{') && (path != NULL)) {
+        start = path + strlen("\"path\":\"");
+        len   = strcspn(start, "\"");
+    }
+
+    len = (len < DEVICE_LEN) ? len : DEVICE_LEN - 1;
+    memcpy(name, start, len);
+    name[len] = '\0';
+}
+
+static void print_missing(const device_t* d) {
+    seq_range_t ranges[MAX_RANGES];
+    size_t      count = seq_window_missing(&d->window, ranges, MAX_RANGES);
+    if (count == 0) {
+        return;
+    }
+
+    printf("{\"device\":\"%s\",\"missing\":[", d->name);
+    for (size_t i = 0; i < count; i++) {
+        printf("%s[%u,%u]", i ? "," : "", ranges[i].first, ranges[i].last);
+    }
+    printf("]}\n");
+}
+
+static void check(device_t* d, uint32_t seq) {
+    uint32_t     head   = d->window.head;
+    bool         first  = !d->window.started;
+    seq_result_t result = seq_window_check(&d->window, seq);
+    d->gap |= (result == SEQ_NEW) && !first && (seq != head + 1);
+    printf("{\"device\":\"%s\",\"seq\":%u,\"status\":\"%s\"}\n", d->name, seq, m_status[result]);
+}
+
+static void ingest_relay(const char* name, const char* line) {
+    device_t* touched[MAX_TOUCHED];
+    size_t    count = 0;
+
+    // one window per leaf, each record carries its leaf before its number
+    for (const char* p = strstr(line, "\"leaf\": \""); p != NULL; p = strstr(p + 1, "\"leaf\": \"")) {
+        char        key[DEVICE_LEN + 1 + LEAF_LEN];
+        const char* leaf = p + strlen("\"leaf\": \"");
+        const char* seq  = strstr(leaf, "\"seq\":");
+        if (seq == NULL) {
+            break;
+        }
+        snprintf(key, sizeof(key), "%s/%.*s", name, (int)strcspn(leaf, "\""), leaf);
+
+        device_t* d = device_get(key);
+        if (d == NULL) {
+            fprintf(stderr, "Too many devices, %s ignored\n", key);
+            continue;
+        }
+        if (!d->gap && (count < MAX_TOUCHED)) {
+            touched[count++] = d;
+        }
+        check(d, (uint32_t)strtoul(seq + strlen("\"seq\":"), NULL, 10));
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (touched[i]->gap) {
+            print_missing(touched[i]);
+            touched[i]->gap = false;
+        }
+    }
+}
+
+static void ingest(char* line) {
+    char name[DEVICE_LEN];
+    device_name(line, name);
+
+    if (strstr(line, "\"type\": \"relay\"") != NULL) {
+        ingest_relay(name, line);
+        fflush(stdout);
+        return;
+    }
+
+    device_t* d = device_get(name);
+    if (d == NULL) {
+        fprintf(stderr, "Too many devices, %s ignored\n", name);
+        return;
+    }
+
+    // a boot announces its first number, the numbers skipped below are not missing
+    const char* p = strstr(line, "\"sync\", \"boot\"");
+    if (p != NULL) {
+        p = strstr(p, "\"seq\":");
+        if (p != NULL) {
+            seq_window_skip(&d->window, (uint32_t)strtoul(p + strlen("\"seq\":"), NULL, 10));
+        }
+        return;
+    }
+
+    for (p = strstr(line, "\"seq\":"); p != NULL; p = strstr(p + 1, "\"seq\":")) {
+        check(d, (uint32_t)strtoul(p + strlen("\"seq\":"), NULL, 10));
+    }
+    if (d->gap) {
+        print_missing(d);
+        d->gap = false;
+    }
+    fflush(stdout);
+}
+
+int main(void) {
+    static char line[LINE_LEN];
+    while (fgets(line, sizeof(line), stdin) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] != '\0') {
+            ingest(line);
+        }
+    }
+
+    for (size_t i = 0; i < MAX_DEVICES; i++) {
+        const device_t* d = &m_devices[i];
+        if (d->name[0] == '\0') {
+            continue;
+        }
+        print_missing(d);
+        printf("{\"device\":\"%s\",\"head\":%u,\"accepted\":%llu,\"late\":%llu,\"duplicates\":%llu,\"stale\":%llu,"
+               "\"lost\":%llu}\n",
+               d->name, d->window.head, (unsigned long long)d->window.stats.accepted,
+               (unsigned long long)d->window.stats.late, (unsigned long long)d->window.stats.duplicates,
+               (unsigned long long)d->window.stats.stale, (unsigned long long)d->window.stats.lost);
+    }
+    return 0;
+}
+
+/** @} */
@@ -0,0 +1,176 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    seq_window.c
+ * @brief   Record sequence duplicate and gap detection.
+ * @note    One bit per sequence number in a ring of SEQ_WINDOW_BITS below the
+ *          highest number received, as the anti-replay window of IPsec. Each
+ *          check runs in O(1): a bit test, and when the window slides forward,
+ *          clearing the bits of the numbers that leave it (amortized one bit
+ *          per number, a whole word at a time).
+ * @author  ael-mess
+ *
+ * @addtogroup TOOLS
+ * @{
+ */
+
+#include "string.h"
+
+#include "seq_window.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define BIT_MASK (SEQ_WINDOW_BITS - 1)
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static bool bit_test(const seq_window_t* w, uint32_t seq) {
+    return (w->bits[(seq & BIT_MASK) / 64] >> (seq % 64)) & 1;
+}
+
+static void bit_set(seq_window_t* w, uint32_t seq) { w->bits[(seq & BIT_MASK) / 64] |= 1ULL << (seq % 64); }
+
+static void slide(seq_window_t* w, uint32_t seq) {
+    uint32_t shift = seq - w->head;
+
+    // the numbers head + 1 - SEQ_WINDOW_BITS .. seq - SEQ_WINDOW_BITS leave the window
+    if (shift >= SEQ_WINDOW_BITS) {
+        uint64_t received = 0;
+        for (int i = 0; i < SEQ_WINDOW_WORDS; i++) {
+            received += __builtin_popcountll(w->bits[i]);
+        }
+        w->stats.lost += (uint64_t)(shift - SEQ_WINDOW_BITS) + (SEQ_WINDOW_BITS - received);
+        memset(w->bits, 0, sizeof(w->bits));
+    } else {
+        // ring positions head + 1 .. seq hold the numbers leaving the window
+        uint32_t pos = w->head + 1;
+        uint32_t end = seq + 1;
+        while (pos != end) {
+            uint32_t word = (pos & BIT_MASK) / 64;
+            uint32_t bit  = pos % 64;
+            uint32_t n    = ((64 - bit) < (end - pos)) ? (64 - bit) : (end - pos);
+            uint64_t mask = (n == 64) ? ~0ULL : (((1ULL << n) - 1) << bit);
+
+            w->stats.lost += n - __builtin_popcountll(w->bits[word] & mask);
+            w->bits[word] &= ~mask;
+            pos += n;
+        }
+    }
+    w->head = seq;
+}
+
+/**
+ * @brief   Initialize a window.
+ *
+ * @param[out] w    window pointer
+ *
+ */
+void seq_window_init(seq_window_t* w) { memset(w, 0, sizeof(seq_window_t)); }
+
+/**
+ * @brief   Account the numbers skipped by a device boot.
+ * @note    A device losing power resumes at its reserved high-water mark, the
+ *          missing numbers right below the first number of the boot were never
+ *          used and are marked received. Numbers far below the window mean the
+ *          device numbering restarted, the window restarts at first.
+ *
+ * @param[in,out] w window pointer
+ * @param[in] first first number of the boot
+ *
+ */
+void seq_window_skip(seq_window_t* w, uint32_t first) {
+    int32_t ahead = (int32_t)(first - w->head);
+    if (!w->started || (ahead < -(int32_t)SEQ_WINDOW_BITS)) {
+        memset(w->bits, 0xff, sizeof(w->bits));
+        w->started = true;
+        w->head    = first - 1;
+        return;
+    }
+
+    if (ahead > 1) {
+        uint32_t skipped = (uint32_t)ahead - 1;
+        slide(w, first - 1);
+        // skipped numbers beyond the window were counted as lost
+        w->stats.lost -= (skipped > SEQ_WINDOW_BITS) ? skipped - SEQ_WINDOW_BITS : 0;
+    }
+
+    for (uint32_t seq = first - 1; (uint32_t)(w->head - seq) < SEQ_WINDOW_BITS && !bit_test(w, seq); seq--) {
+        bit_set(w, seq);
+    }
+}
+
+/**
+ * @brief   Check a received sequence number.
+ *
+ * @param[in,out] w window pointer
+ * @param[in] seq   received sequence number
+ * @return          reception result, only SEQ_NEW and SEQ_LATE records are to be ingested
+ *
+ */
+seq_result_t seq_window_check(seq_window_t* w, uint32_t seq) {
+    if (!w->started) {
+        seq_window_skip(w, seq);
+    }
+
+    // serial number arithmetic, numbers wrap around at 2^32
+    int32_t ahead = (int32_t)(seq - w->head);
+    if (ahead > 0) {
+        slide(w, seq);
+        bit_set(w, seq);
+        w->stats.accepted++;
+        return SEQ_NEW;
+    }
+    if ((uint32_t)-ahead >= SEQ_WINDOW_BITS) {
+        w->stats.stale++;
+        return SEQ_STALE;
+    }
+    if (bit_test(w, seq)) {
+        w->stats.duplicates++;
+        return SEQ_DUPLICATE;
+    }
+
+    bit_set(w, seq);
+    w->stats.accepted++;
+    w->stats.late++;
+    return SEQ_LATE;
+}
+
+/**
+ * @brief   List the missing numbers of the window.
+ *
+ * @param[in] w         window pointer
+ * @param[out] ranges   missing ranges, oldest first
+ * @param[in] max       ranges size
+ * @return              number of ranges
+ *
+ */
+size_t seq_window_missing(const seq_window_t* w, seq_range_t* ranges, size_t max) {
+    size_t count = 0;
+    bool   open  = false;
+
+    if (!w->started) {
+        return 0;
+    }
+
+    for (uint32_t i = SEQ_WINDOW_BITS - 1; i > 0; i--) {
+        uint32_t seq = w->head - i;
+        if (!bit_test(w, seq)) {
+            if (!open) {
+                if (count == max) {
+                    break;
+                }
+                ranges[count].first = seq;
+                open                = true;
+                count++;
+            }
+            ranges[count - 1].last = seq;
+        } else {
+            open = false;
+        }
+    }
+    return count;
+}
+
+/** @} */
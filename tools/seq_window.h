@@ -0,0 +1,67 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    seq_window.h
+ * @brief   Record sequence duplicate and gap detection.
+ * @author  ael-mess
+ *
+ * @addtogroup TOOLS
+ * @{
+ */
+
+#ifndef _SEQ_WINDOW_H_
+#define _SEQ_WINDOW_H_
+
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+/*===========================================================================*/
+/* External definitions.                                                     */
+/*===========================================================================*/
+#define SEQ_WINDOW_BITS  1024 /* sequence numbers tracked below the highest one, power of 2 */
+#define SEQ_WINDOW_WORDS (SEQ_WINDOW_BITS / 64)
+
+typedef enum {
+    SEQ_NEW = 0,   /* first reception, in order or after a gap */
+    SEQ_LATE,      /* first reception, fills a gap */
+    SEQ_DUPLICATE, /* already received */
+    SEQ_STALE,     /* older than the window, cannot be told apart, dropped */
+} seq_result_t;
+
+typedef struct {
+    uint32_t first; /* first missing number */
+    uint32_t last;  /* last missing number */
+} seq_range_t;
+
+typedef struct {
+    uint64_t accepted;   /* SEQ_NEW and SEQ_LATE */
+    uint64_t late;       /* SEQ_LATE */
+    uint64_t duplicates; /* SEQ_DUPLICATE */
+    uint64_t stale;      /* SEQ_STALE */
+    uint64_t lost;       /* numbers that left the window without being received */
+} seq_stats_t;
+
+typedef struct {
+    bool        started;
+    uint32_t    head;                   /* highest number received */
+    uint64_t    bits[SEQ_WINDOW_WORDS]; /* received flags, bit (seq % SEQ_WINDOW_BITS) */
+    seq_stats_t stats;
+} seq_window_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void         seq_window_init(seq_window_t* w);
+void         seq_window_skip(seq_window_t* w, uint32_t first);
+seq_result_t seq_window_check(seq_window_t* w, uint32_t seq);
+size_t       seq_window_missing(const seq_window_t* w, seq_range_t* ranges, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SEQ_WINDOW_H_ */
+
+/** @} */
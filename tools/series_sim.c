@@ -0,0 +1,183 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    series_sim.c
+ * @brief   Counter history store on an emulated flash.
+ * @note    Appends one point per minute of a synthetic office occupancy, with
+ *          outages, some of them losing power in the middle of a flash write
+ *          and restarting the store from flash. The store content is checked
+ *          against the appended points, then the cost of range queries is
+ *          measured in flash time:
+ *          ./tools/build/series_sim [days] [partition_kb] [seed]
+ * @author  ael-mess
+ *
+ * @addtogroup TOOLS
+ * @{
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#include "app_series.h"
+#include "flash_emu.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define SECTOR_SIZE  4096
+#define START_MINUTE 27769680 /* 2022-10-19 00:00 UTC */
+#define DAY          (24 * 60)
+#define OUTAGE_RATE  2000 /* one outage every so many minutes on average */
+#define OUTAGE_MAX   300  /* minutes */
+#define CHUNK        256  /* points per query step */
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static app_series_t       m_series;
+static flash_emu_t        m_flash;
+static app_series_flash_t m_ops;
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static uint16_t occupancy(uint32_t minute, uint16_t value) {
+    // people come in from 8:00, leave from 17:00, nobody at night
+    uint32_t hour = (minute % DAY) / 60;
+    int      r    = rand() % 100;
+    if ((hour >= 8) && (hour < 17) && (r < 20)) {
+        value += (uint16_t)(1 + (r % 3));
+    } else if ((hour >= 12) && (value > 0) && (r >= 85)) {
+        value--;
+    } else if ((hour >= 19) || (hour < 6)) {
+        value = 0;
+    }
+    return (value > 400) ? 400 : value;
+}
+
+static void restart(void) {
+    m_flash.lost       = false;
+    m_flash.fail_after = 0;
+    if (app_series_init(&m_series, &m_ops) != 0) {
+        fprintf(stderr, "Store restart failed\n");
+        exit(1);
+    }
+}
+
+static size_t query_all(uint32_t from, uint32_t to, app_series_point_t* out, size_t max) {
+    static app_series_point_t chunk[CHUNK];
+    size_t                    n = 0;
+
+    // step by step, as a backfill request is served
+    while (from <= to) {
+        size_t got = app_series_query(&m_series, from, to, chunk, CHUNK);
+        for (size_t i = 0; (i < got) && (n < max); i++) {
+            out[n++] = chunk[i];
+        }
+        if (got < CHUNK) {
+            break;
+        }
+        from = chunk[got - 1].minute + 1;
+    }
+    return n;
+}
+
+static void query_cost(const char* name, uint32_t minutes, app_series_point_t* out, size_t max) {
+    flash_emu_stats_t before = m_flash.stats;
+    uint32_t          reads  = m_series.stats.blocks_read;
+    uint32_t          to     = m_series.last_minute;
+    size_t            n      = query_all(to - minutes + 1, to, out, max);
+
+    printf("{\"query\":\"%s\",\"points\":%zu,\"blocks\":%u,\"read_bytes\":%llu,\"flash_us\":%.0f}\n", name, n,
+           m_series.stats.blocks_read - reads, (unsigned long long)(m_flash.stats.read_bytes - before.read_bytes),
+           m_flash.stats.busy_us - before.busy_us);
+}
+
+int main(int argc, char** argv) {
+    uint32_t days = (argc > 1) ? (uint32_t)atoi(argv[1]) : 45;
+    uint32_t size = (argc > 2) ? (uint32_t)atoi(argv[2]) * 1024 : 128 * 1024;
+    unsigned seed = (argc > 3) ? (unsigned)atoi(argv[3]) : 1;
+    srand(seed);
+
+    uint8_t*            data   = malloc(size);
+    app_series_point_t* truth  = malloc(sizeof(app_series_point_t) * days * DAY);
+    app_series_point_t* points = malloc(sizeof(app_series_point_t) * days * DAY);
+    size_t              stored = 0;
+
+    flash_emu_init(&m_flash, data, size, SECTOR_SIZE);
+    m_ops = (app_series_flash_t){
+        .read        = flash_emu_read,
+        .write       = flash_emu_write,
+        .erase       = flash_emu_erase,
+        .ctx         = &m_flash,
+        .size        = size,
+        .sector_size = SECTOR_SIZE,
+    };
+    restart();
+
+    uint16_t value    = 0;
+    uint32_t outages  = 0;
+    uint32_t torn     = 0;
+    uint32_t restarts = 0;
+    for (uint32_t minute = START_MINUTE; minute < START_MINUTE + days * DAY; minute++) {
+        value = occupancy(minute, value);
+
+        if ((rand() % OUTAGE_RATE) == 0) {
+            outages++;
+            if (rand() % 2) {
+                // power lost while this point is written
+                torn++;
+                m_flash.fail_after = 1;
+                app_series_append(&m_series, minute, value);
+            }
+            restart();
+            restarts++;
+            minute += 1 + rand() % OUTAGE_MAX;
+            continue;
+        }
+
+        if (app_series_append(&m_series, minute, value) == 0) {
+            truth[stored].minute  = minute;
+            truth[stored++].value = value;
+        }
+    }
+
+    double write_us = m_flash.stats.busy_us;
+    printf("{\"days\":%u,\"partition_kb\":%u,\"points\":%zu,\"bytes\":%llu,\"bytes_per_point\":%.2f,\"blocks\":%u,"
+           "\"erases\":%llu,\"violations\":%llu,\"outages\":%u,\"torn\":%u,\"write_us_per_point\":%.1f}\n",
+           days, size / 1024, stored, (unsigned long long)m_flash.stats.write_bytes,
+           (double)m_flash.stats.write_bytes / stored, m_series.count, (unsigned long long)m_flash.stats.erases,
+           (unsigned long long)m_flash.stats.violations, outages, torn, write_us / stored);
+
+    // everything within the retention and still on flash must come back unchanged
+    restart();
+    uint32_t retention = APP_SERIES_RETENTION_DAYS * DAY;
+    uint32_t last      = truth[stored - 1].minute;
+    uint32_t from      = (last >= retention) ? last - retention + 1 : 0;
+    uint32_t oldest    = m_series.first[m_series.oldest];
+    from               = (oldest > from) ? oldest : from;
+
+    size_t first = 0;
+    while ((first < stored) && (truth[first].minute < from)) {
+        first++;
+    }
+    size_t n          = query_all(from, last, points, days * DAY);
+    size_t mismatches = (n == (stored - first)) ? 0 : 1;
+    for (size_t i = 0; (i < n) && (mismatches == 0); i++) {
+        mismatches += (points[i].minute != truth[first + i].minute) || (points[i].value != truth[first + i].value);
+    }
+    printf("{\"retained_days\":%.1f,\"checked\":%zu,\"mismatches\":%zu,\"restarts\":%u}\n",
+           (last - from + 1) / (double)DAY, n, mismatches, restarts);
+
+    query_cost("hour", 60, points, days * DAY);
+    query_cost("day", DAY, points, days * DAY);
+    query_cost("month", 30 * DAY, points, days * DAY);
+
+    free(points);
+    free(truth);
+    free(data);
+    return mismatches ? 1 : 0;
+}
+
+/** @} */
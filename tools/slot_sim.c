@@ -0,0 +1,141 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    slot_sim.c
+ * @brief   Broker load of a fleet powered at once, with and without slots.
+ * @note    Devices with consecutive MACs get their WiFi back together after a
+ *          site power restore, connect, then publish one record per period.
+ *          Midway, the broker restarts: devices reconnect and drain the
+ *          records queued meanwhile, paced per slot like the publish task.
+ *          Connections and messages reaching the broker are counted per
+ *          100 ms, with the offsets of app_slot:
+ *          ./tools/build/slot_sim [devices] [spread_ms] [period_ms] [drain_per_slot]
+ * @author  ael-mess
+ *
+ * @addtogroup TOOLS
+ * @{
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#include "app_slot.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define BIN_MS       100
+#define DURATION_MS  120000
+#define BINS         (DURATION_MS / BIN_MS)
+#define WIFI_MS      2000  /* access point back after power restore */
+#define WIFI_JITTER  300   /* association spread */
+#define TASK_MS      50    /* connection to first sample */
+#define OUTAGE_MS    60000 /* broker restart */
+#define OUTAGE_LEN   10000
+#define DETECT_MS    500   /* disconnection noticed within */
+#define RECONNECT_MS 10000 /* esp-mqtt reconnect timeout */
+#define DRAIN_MS     5     /* per backlog message, unpaced */
+
+typedef struct {
+    uint32_t connects[BINS];
+    uint32_t messages[BINS];
+} load_t;
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static void count(uint32_t* bins, int64_t t_ms) {
+    if ((t_ms >= 0) && (t_ms < DURATION_MS)) {
+        bins[t_ms / BIN_MS]++;
+    }
+}
+
+static int64_t next_ms(int64_t now_ms, uint32_t period_ms, uint32_t offset_ms) {
+    return app_slot_next(now_ms * 1000, period_ms, offset_ms) / 1000;
+}
+
+static void device(load_t* load, uint32_t index, uint32_t spread_ms, uint32_t period_ms, uint32_t drain_per_slot) {
+    // one vendor batch, consecutive MACs
+    uint8_t  mac[6] = {0x24, 0x0a, 0xc4, (uint8_t)(index >> 16), (uint8_t)(index >> 8), (uint8_t)index};
+    uint32_t offset = app_slot_offset(mac, spread_ms);
+
+    int64_t connect = WIFI_MS + rand() % WIFI_JITTER + offset;
+    count(load->connects, connect);
+
+    // periodic records until the broker goes down
+    int64_t t = next_ms(connect + TASK_MS, period_ms, offset);
+    for (; t < OUTAGE_MS; t += period_ms) {
+        count(load->messages, t);
+    }
+
+    // reconnection, at the first attempt after the broker is back
+    int64_t lost      = OUTAGE_MS + rand() % DETECT_MS;
+    int64_t reconnect = lost + RECONNECT_MS + offset;
+    while (reconnect < OUTAGE_MS + OUTAGE_LEN) {
+        reconnect += RECONNECT_MS + offset;
+    }
+    count(load->connects, reconnect);
+
+    // the backlog drains drain_per_slot messages per slot period from the device slot, the records queued
+    // meanwhile behind it, then the records resume in phase
+    uint32_t step  = spread_ms / drain_per_slot;
+    int64_t  drain = next_ms(reconnect + 1, step, offset);
+    for (; (t < drain) && (t < DURATION_MS); t += period_ms) {
+        count(load->messages, drain);
+        drain += step ? step : DRAIN_MS;
+    }
+    for (; t < DURATION_MS; t += period_ms) {
+        count(load->messages, t);
+    }
+}
+
+static int cmp_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char* mode, const uint32_t* bins, const char* what) {
+    static uint32_t sorted[BINS];
+    uint64_t        sum  = 0;
+    size_t          busy = 0;
+
+    // idle intervals left out, a burst over a few of them would hide below the percentile
+    for (size_t i = 0; i < BINS; i++) {
+        sum += bins[i];
+        if (bins[i] > 0) {
+            sorted[busy++] = bins[i];
+        }
+    }
+    qsort(sorted, busy, sizeof(uint32_t), cmp_u32);
+
+    printf("{\"mode\":\"%s\",\"load\":\"%s\",\"total\":%llu,\"busy_bins\":%zu,\"mean_per_busy_bin\":%.1f,"
+           "\"p99_per_busy_bin\":%u,\"peak_per_bin\":%u}\n",
+           mode, what, (unsigned long long)sum, busy, busy ? (double)sum / busy : 0.0,
+           busy ? sorted[busy * 99 / 100] : 0, busy ? sorted[busy - 1] : 0);
+}
+
+int main(int argc, char** argv) {
+    uint32_t devices   = (argc > 1) ? (uint32_t)atoi(argv[1]) : 1000;
+    uint32_t spread_ms = (argc > 2) ? (uint32_t)atoi(argv[2]) : 1000;
+    uint32_t period_ms = (argc > 3) ? (uint32_t)atoi(argv[3]) : 1000;
+    uint32_t drain     = (argc > 4) ? (uint32_t)atoi(argv[4]) : 4;
+    if ((period_ms == 0) || (drain == 0)) {
+        fprintf(stderr, "Invalid period or drain rate\n");
+        return 1;
+    }
+
+    static load_t loads[2];
+    for (int slotted = 0; slotted < 2; slotted++) {
+        srand(1);
+        for (uint32_t i = 0; i < devices; i++) {
+            device(&loads[slotted], i, slotted ? spread_ms : 0, period_ms, drain);
+        }
+        report(slotted ? "slots" : "no-slots", loads[slotted].connects, "connects");
+        report(slotted ? "slots" : "no-slots", loads[slotted].messages, "messages");
+    }
+    return 0;
+}
+
+/** @} */
@@ -0,0 +1,217 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    tof_replay.c
+ * @brief   People counting accuracy on replayed depth frames.
+ * @note    Replays a synthetic scene through the segmentation and the tracker
+ *          and matches each counted crossing to a ground truth crossing of
+ *          the same direction within MATCH_S, the others are misses and
+ *          false positives. One line for the open scene, one for the lane
+ *          scene:
+ *          ./tools/build/tof_replay [minutes] [rate_hz] [seed]
+ *          A raw recording (64 little endian uint16 depths in mm per frame)
+ *          is replayed with -f, it has no ground truth:
+ *          ./tools/build/tof_replay -f frames.bin [rate_hz]
+ * @author  ael-mess
+ *
+ * @addtogroup TOOLS
+ * @{
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+
+#include "app_scene.h"
+#include "app_tof.h"
+#include "app_track.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define MATCH_S   1.0f /* counted and true crossings further apart do not match */
+#define MATCH_MAX 16   /* unmatched crossings pending per direction */
+
+typedef struct {
+    uint32_t truth[MATCH_MAX]; /* frames of the unmatched true crossings, oldest first */
+    uint32_t count[MATCH_MAX]; /* frames of the unmatched counted crossings, oldest first */
+    size_t   truth_len;
+    size_t   count_len;
+} match_t;
+
+typedef struct {
+    uint32_t frames;
+    uint32_t in;
+    uint32_t out;
+    uint64_t max_ns; /* slowest frame */
+    uint64_t sum_ns;
+    match_t  match[2]; /* by app_track_dir_t */
+    uint32_t matched;
+    uint32_t misses;
+    uint32_t false_pos;
+} replay_t;
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static app_tof_t   m_tof;
+static app_track_t m_track;
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void match_pop(uint32_t* list, size_t* len) {
+    memmove(list, list + 1, (*len - 1) * sizeof(uint32_t));
+    (*len)--;
+}
+
+static void match_add(replay_t* r, app_track_dir_t dir, bool truth, uint32_t frame) {
+    match_t*  m       = &r->match[dir];
+    uint32_t* other   = truth ? m->count : m->truth;
+    size_t*   other_n = truth ? &m->count_len : &m->truth_len;
+    if (*other_n > 0) {
+        match_pop(other, other_n);
+        r->matched++;
+        return;
+    }
+
+    uint32_t* list = truth ? m->truth : m->count;
+    size_t*   n    = truth ? &m->truth_len : &m->count_len;
+    if (*n == MATCH_MAX) {
+        // too many pending, the oldest one is given up
+        match_pop(list, n);
+        if (truth) {
+            r->misses++;
+        } else {
+            r->false_pos++;
+        }
+    }
+    list[(*n)++] = frame;
+}
+
+static void match_expire(replay_t* r, uint32_t frame, uint32_t window) {
+    for (int dir = 0; dir < 2; dir++) {
+        match_t* m = &r->match[dir];
+        while ((m->truth_len > 0) && (frame - m->truth[0] > window)) {
+            match_pop(m->truth, &m->truth_len);
+            r->misses++;
+        }
+        while ((m->count_len > 0) && (frame - m->count[0] > window)) {
+            match_pop(m->count, &m->count_len);
+            r->false_pos++;
+        }
+    }
+}
+
+static void replay_frame(replay_t* r, const uint16_t depth[APP_TOF_PIXELS]) {
+    app_tof_blob_t    blobs[APP_TOF_MAX_BLOBS];
+    app_track_event_t events[APP_TRACK_MAX];
+
+    uint64_t start  = now_ns();
+    size_t   count  = app_tof_process(&m_tof, depth, blobs, APP_TOF_MAX_BLOBS);
+    size_t   events_count = app_track_update(&m_track, blobs, count, events, APP_TRACK_MAX);
+    uint64_t ns     = now_ns() - start;
+
+    for (size_t i = 0; i < events_count; i++) {
+        if (events[i].dir == APP_TRACK_IN) {
+            r->in++;
+        } else {
+            r->out++;
+        }
+        match_add(r, events[i].dir, false, r->frames);
+    }
+    r->frames++;
+    r->sum_ns += ns;
+    r->max_ns = (ns > r->max_ns) ? ns : r->max_ns;
+}
+
+static void replay_print(const replay_t* r, uint32_t rate_hz) {
+    printf("\"frames\":%u,\"rate_hz\":%u,\"in\":%u,\"out\":%u,\"frame_ns\":%.1f,\"max_frame_ns\":%llu", r->frames,
+           rate_hz, r->in, r->out, r->frames ? (double)r->sum_ns / r->frames : 0.0, (unsigned long long)r->max_ns);
+}
+
+static int replay_file(const char* path, uint32_t rate_hz) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return 1;
+    }
+
+    replay_t r = {0};
+    uint8_t  raw[APP_TOF_PIXELS * 2];
+    while (fread(raw, sizeof(raw), 1, f) == 1) {
+        uint16_t depth[APP_TOF_PIXELS];
+        for (int i = 0; i < APP_TOF_PIXELS; i++) {
+            depth[i] = (uint16_t)(raw[2 * i] | (raw[2 * i + 1] << 8));
+        }
+        replay_frame(&r, depth);
+    }
+    fclose(f);
+
+    printf("{\"file\":\"%s\",", path);
+    replay_print(&r, rate_hz);
+    printf("}\n");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    app_tof_init(&m_tof);
+    app_track_init(&m_track);
+
+    if ((argc > 2) && !strcmp(argv[1], "-f")) {
+        return replay_file(argv[2], (argc > 3) ? (uint32_t)atoi(argv[3]) : 15);
+    }
+
+    uint32_t minutes = (argc > 1) ? (uint32_t)atoi(argv[1]) : 60;
+    uint32_t rate_hz = (argc > 2) ? (uint32_t)atoi(argv[2]) : 15;
+    uint32_t seed    = (argc > 3) ? (uint32_t)atoi(argv[3]) : 1;
+    if ((rate_hz == 0) || (APP_TRACK_LINE != (int)(APP_SCENE_LINE * 10))) {
+        fprintf(stderr, "Invalid rate or counting line\n");
+        return 1;
+    }
+
+    // the open scene, then the corridor where each direction keeps to its half
+    for (int lanes = 0; lanes < 2; lanes++) {
+        app_tof_init(&m_tof);
+        app_track_init(&m_track);
+        app_scene_t scene;
+        app_scene_init(&scene, seed, rate_hz);
+        scene.lanes = lanes;
+
+        replay_t r      = {0};
+        uint32_t window = (uint32_t)(MATCH_S * rate_hz);
+        for (uint32_t i = 0; i < minutes * 60 * rate_hz; i++) {
+            uint16_t depth[APP_TOF_PIXELS];
+            app_scene_frame(&scene, depth);
+            for (int j = 0; j < scene.frame_in; j++) {
+                match_add(&r, APP_TRACK_IN, true, r.frames);
+            }
+            for (int j = 0; j < scene.frame_out; j++) {
+                match_add(&r, APP_TRACK_OUT, true, r.frames);
+            }
+            replay_frame(&r, depth);
+            match_expire(&r, r.frames, window);
+        }
+        match_expire(&r, r.frames + window + 1, window);
+
+        // a miss and a false positive would cancel in the totals, both are errors
+        uint32_t truth = scene.in + scene.out;
+        uint32_t error = r.misses + r.false_pos;
+        printf("{\"scene\":\"%s\",\"seed\":%u,", lanes ? "lanes" : "open", seed);
+        replay_print(&r, rate_hz);
+        printf(",\"truth_in\":%u,\"truth_out\":%u,\"matched\":%u,\"misses\":%u,\"false_positives\":%u,"
+               "\"accuracy\":%.2f,\"born\":%u,\"rejected\":%u}\n",
+               scene.in, scene.out, r.matched, r.misses, r.false_pos,
+               truth ? 100.0 * (1.0 - (double)error / truth) : 100.0, m_track.stats.born, m_track.stats.rejected);
+    }
+    return 0;
+}
+
+/** @} */
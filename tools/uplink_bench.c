@@ -0,0 +1,215 @@
+/**
+ * Copyright (C) 2022 ael-mess
+ *
+ * @file    uplink_bench.c
+ * @brief   Uplink transport cost per count.
+ * @note    Compares bytes on air, airtime and radio energy per counter record
+ *          for each uplink transport, frames are built from the firmware record
+ *          format and the CoAP codec:
+ *          ./tools/build/uplink_bench [interval_s] [batch] [rate_mbps]
+ *          One JSON line is printed per transport. The model counts every frame
+ *          exchanged per record (802.11 data and MAC acknowledge, IP, TCP or UDP,
+ *          TLS records, MQTT keepalive amortized over the records) and the
+ *          listening time of one round trip per exchange. Association, beacons
+ *          and DTIM wake-ups are the same for every transport and are left out.
+ * @author  ael-mess
+ *
+ * @addtogroup TOOLS
+ * @{
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#include "app_coap.h"
+
+/*===========================================================================*/
+/* Local definitions.                                                        */
+/*===========================================================================*/
+#define TOPIC          "iot/dev/Default/data"
+#define PATH           "c/Default"
+#define KEEPALIVE_S    60   /* esp-mqtt pings every half keepalive period (120 s) */
+#define MAC_OVERHEAD   54   /* 802.11 QoS data header, LLC/SNAP, CCMP and FCS */
+#define MAC_ACK_BYTES  14   /* 802.11 acknowledge frame */
+#define IP_TCP         40   /* IPv4 and TCP headers, lwIP sends no timestamps */
+#define IP_UDP         28   /* IPv4 and UDP headers */
+#define TLS_RECORD     29   /* TLS 1.2 AES-GCM record header, explicit nonce and tag */
+#define PREAMBLE_US    20   /* OFDM preamble and signal field */
+#define SIFS_US        16
+#define DIFS_US        34
+#define BACKOFF_US     68   /* mean backoff, CWmin 15 slots of 9 us */
+#define TX_MA          190  /* ESP32 802.11g transmit current */
+#define RX_MA          100  /* ESP32 receive current */
+#define SUPPLY_MV      3300
+#define RTT_US         20000 /* listening time while an answer is awaited */
+
+typedef enum { DEVICE_TX = 0, DEVICE_RX } dir_t;
+
+typedef struct {
+    const char* name;
+    double      app_bytes; /* application layer bytes, both directions */
+    double      ip_bytes;  /* IP datagram bytes, both directions */
+    double      air_bytes; /* 802.11 frame bytes, MAC acknowledges included */
+    double      frames;    /* 802.11 data frames */
+    double      tx_us;     /* device transmit airtime */
+    double      rx_us;     /* device receive airtime */
+    double      listen_us; /* device waiting for an answer */
+} cost_t;
+
+/*===========================================================================*/
+/* Local variables.                                                          */
+/*===========================================================================*/
+static double m_rate_mbps = 6;
+
+/*===========================================================================*/
+/* Local functions.                                                          */
+/*===========================================================================*/
+static double airtime_us(uint32_t bytes) {
+    // OFDM: 16 service bits, 6 tail bits, 4 us symbols
+    double bits_per_symbol = m_rate_mbps * 4;
+    double symbols         = (16 + 6 + 8.0 * bytes + bits_per_symbol - 1) / bits_per_symbol;
+    return PREAMBLE_US + 4 * (double)(long)symbols;
+}
+
+static void frame(cost_t* c, dir_t dir, uint32_t app, uint32_t ip_payload, uint32_t ip_header) {
+    uint32_t ip  = ip_payload + ip_header;
+    uint32_t air = ip + MAC_OVERHEAD;
+
+    c->app_bytes += app;
+    c->ip_bytes += ip;
+    c->air_bytes += air + MAC_ACK_BYTES;
+    c->frames++;
+
+    // data frame from the sender, acknowledge from the receiver after SIFS
+    double data = DIFS_US + BACKOFF_US + airtime_us(air);
+    double ack  = SIFS_US + airtime_us(MAC_ACK_BYTES);
+    if (dir == DEVICE_TX) {
+        c->tx_us += data;
+        c->rx_us += ack;
+    } else {
+        c->rx_us += data;
+        c->tx_us += ack;
+    }
+}
+
+static uint32_t varint_len(uint32_t value) { return (value < 128) ? 1 : (value < 16384) ? 2 : 3; }
+
+static uint32_t mqtt_publish_len(uint32_t payload, int qos) {
+    uint32_t remaining = 2 + strlen(TOPIC) + (qos ? 2 : 0) + payload;
+    return 1 + varint_len(remaining) + remaining;
+}
+
+static uint32_t coap_len(const char* payload, int token_len, int no_response) {
+    app_coap_msg_t msg = {
+        .type        = APP_COAP_NON,
+        .code        = (payload != NULL) ? APP_COAP_POST : APP_COAP_CHANGED,
+        .token_len   = token_len,
+        .format      = (payload != NULL) ? APP_COAP_JSON : APP_COAP_NO_FORMAT,
+        .no_response = no_response,
+        .payload     = (const uint8_t*)payload,
+        .payload_len = (payload != NULL) ? strlen(payload) : 0,
+    };
+    if (payload != NULL) {
+        strcpy(msg.path, PATH);
+    }
+
+    uint8_t buf[1500];
+    return app_coap_encode(&msg, buf, sizeof(buf));
+}
+
+static void cost_mqtt(cost_t* c, const char* payload, int qos, int tls, double interval_s, int batch) {
+    uint32_t tls_overhead = tls ? TLS_RECORD : 0;
+    uint32_t publish      = mqtt_publish_len(strlen(payload), qos);
+
+    frame(c, DEVICE_TX, publish, publish + tls_overhead, IP_TCP);
+    if (qos) {
+        // PUBACK carries the TCP acknowledge, its own acknowledge is sent on the delayed ACK timer
+        frame(c, DEVICE_RX, 4, 4 + tls_overhead, IP_TCP);
+        frame(c, DEVICE_TX, 0, 0, IP_TCP);
+    } else {
+        frame(c, DEVICE_RX, 0, 0, IP_TCP);
+    }
+    c->listen_us += RTT_US;
+
+    // PINGREQ, PINGRESP and TCP acknowledge, amortized over the messages of one keepalive period
+    double messages = KEEPALIVE_S / (interval_s * batch);
+    cost_t ping     = {0};
+    frame(&ping, DEVICE_TX, 2, 2 + tls_overhead, IP_TCP);
+    frame(&ping, DEVICE_RX, 2, 2 + tls_overhead, IP_TCP);
+    frame(&ping, DEVICE_TX, 0, 0, IP_TCP);
+    ping.listen_us += RTT_US;
+    if (messages < 1) {
+        messages = 1;
+    }
+    c->app_bytes += ping.app_bytes / messages;
+    c->ip_bytes += ping.ip_bytes / messages;
+    c->air_bytes += ping.air_bytes / messages;
+    c->frames += ping.frames / messages;
+    c->tx_us += ping.tx_us / messages;
+    c->rx_us += ping.rx_us / messages;
+    c->listen_us += ping.listen_us / messages;
+}
+
+static void cost_coap(cost_t* c, const char* payload, int acked) {
+    uint32_t request = coap_len(payload, acked ? 2 : 0, !acked);
+    frame(c, DEVICE_TX, request, request, IP_UDP);
+    if (acked) {
+        uint32_t answer = coap_len(NULL, 2, 0);
+        frame(c, DEVICE_RX, answer, answer, IP_UDP);
+        c->listen_us += RTT_US;
+    }
+}
+
+static void print_cost(const cost_t* c, int batch) {
+    double energy_uj = (c->tx_us * TX_MA + (c->rx_us + c->listen_us) * RX_MA) * SUPPLY_MV / 1e6;
+    printf("{\"transport\":\"%s\",\"batch\":%d,\"app_bytes\":%.1f,\"ip_bytes\":%.1f,\"air_bytes\":%.1f,"
+           "\"frames\":%.2f,\"airtime_us\":%.1f,\"energy_uj\":%.1f}\n",
+           c->name, batch, c->app_bytes / batch, c->ip_bytes / batch, c->air_bytes / batch, c->frames / batch,
+           (c->tx_us + c->rx_us) / batch, energy_uj / batch);
+}
+
+static void encode_records(char* buf, int batch) {
+    // same format as app_transport_publish
+    if (batch == 1) {
+        sprintf(buf, "{ \"type\": \"count\", \"seq\": %u, \"value\": %d, \"ts\": %lld, \"sync\": %s }", 104857,
+                12, 1666180800991LL, "true");
+        return;
+    }
+    int n = sprintf(buf, "{ \"type\": \"batch\", \"records\": [");
+    for (int i = 0; i < batch; i++) {
+        n += sprintf(buf + n, "%s{ \"seq\": %u, \"value\": %d, \"ts\": %lld, \"sync\": %s }", i ? ", " : "",
+                     104857 + i, 12, 1666180800991LL + i * 1000, "true");
+    }
+    sprintf(buf + n, "] }");
+}
+
+int main(int argc, char** argv) {
+    double interval_s = (argc > 1) ? atof(argv[1]) : 1;
+    int    batch      = (argc > 2) ? atoi(argv[2]) : 1;
+    m_rate_mbps       = (argc > 3) ? atof(argv[3]) : 6;
+    if ((interval_s <= 0) || (batch < 1) || (batch > 12) || (m_rate_mbps <= 0)) {
+        fprintf(stderr, "usage: %s [interval_s > 0] [batch 1-12] [rate_mbps > 0]\n", argv[0]);
+        return 1;
+    }
+
+    char payload[1200];
+    encode_records(payload, batch);
+
+    cost_t costs[] = {
+        {.name = "mqtt-qos0"}, {.name = "mqtt-qos1"}, {.name = "mqtts-qos1"},
+        {.name = "coap-non"},  {.name = "coap-ack"},
+    };
+    cost_mqtt(&costs[0], payload, 0, 0, interval_s, batch);
+    cost_mqtt(&costs[1], payload, 1, 0, interval_s, batch);
+    cost_mqtt(&costs[2], payload, 1, 1, interval_s, batch);
+    cost_coap(&costs[3], payload, 0);
+    cost_coap(&costs[4], payload, 1);
+
+    for (size_t i = 0; i < sizeof(costs) / sizeof(costs[0]); i++) {
+        print_cost(&costs[i], batch);
+    }
+    return 0;
+}
+
+/** @} */
@@ -0,0 +1,30 @@
+#!/bin/sh
+#
+# Generate a local CA and a mosquitto server certificate for MQTT over TLS tests.
+# The CA is appended to main/certs/ca_bundle.pem to be embedded in the firmware, replacing a previous local CA.
+#
+# usage: utils/gen_certs.sh <broker_ip_address> [output_directory]
+
+set -e
+
+BROKER_IP=${1:?usage: $0 <broker_ip_address> [output_directory]}
+OUT=${2:-certs}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+
+mkdir -p "$OUT"
+
+openssl req -x509 -newkey rsa:2048 -nodes -days 3650 -subj "/CN=personCounter CA" \
+    -keyout "$OUT/ca.key" -out "$OUT/ca.crt"
+
+openssl req -newkey rsa:2048 -nodes -subj "/CN=$BROKER_IP" \
+    -keyout "$OUT/server.key" -out "$OUT/server.csr"
+
+printf "subjectAltName=IP:%s\n" "$BROKER_IP" > "$OUT/server.ext"
+openssl x509 -req -days 3650 -in "$OUT/server.csr" -CA "$OUT/ca.crt" -CAkey "$OUT/ca.key" -CAcreateserial \
+    -extfile "$OUT/server.ext" -out "$OUT/server.crt"
+
+BUNDLE="$ROOT/main/certs/ca_bundle.pem"
+sed -i '/^# personCounter local CA/,$d' "$BUNDLE"
+printf "# personCounter local CA\n" >> "$BUNDLE"
+cat "$OUT/ca.crt" >> "$BUNDLE"
+echo "CA embedded in $BUNDLE"
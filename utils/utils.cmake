@@ -2,6 +2,9 @@ file(GLOB SRC_FILES LIST_DIRECTORIES false
     ${PROJECT_SOURCE_DIR}/main/*.c
     ${PROJECT_SOURCE_DIR}/main/*.cpp
     ${PROJECT_SOURCE_DIR}/main/include/*.h
+    ${PROJECT_SOURCE_DIR}/bench/*.c
+    ${PROJECT_SOURCE_DIR}/bench/*.h
+    ${PROJECT_SOURCE_DIR}/tools/*.c
     )
 
 file(GLOB CFG_FILES LIST_DIRECTORIES false